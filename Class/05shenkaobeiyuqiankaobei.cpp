@@ -2,6 +2,8 @@
 using namespace std;
 
 //深拷贝与浅拷贝
+//移动构造和移动赋值直接把height指针"偷"过来, 不用再new; 都是noexcept, vector扩容时才会用移动而不是拷贝
+//Class/17class.cpp用-DPRESON_NO_MAIN包含这个文件, 统计vector<preson>扩容时new的次数
 
 class preson
 {
@@ -9,16 +11,27 @@ public:
     int age;
     int *height;
 
+    //关掉构造和析构里的输出, 跑大量对象时用
+    static bool quiet;
+
     preson()
     {
-        cout << "无参构造函数" << endl;
+        age = 0;
+        height = NULL;
+        if (!quiet)
+        {
+            cout << "无参构造函数" << endl;
+        }
     }
 
     preson(int a, int b)
     {
         age = a;
         height = new int(b);
-        cout << "有参构造函数" << endl;
+        if (!quiet)
+        {
+            cout << "有参构造函数" << endl;
+        }
         //cout<<"年龄是："<<
     }
     //重载
@@ -26,7 +39,39 @@ public:
     {
         age = p.age;
         //height = p.height;
-        height = new int(*p.height);
+        height = p.height != NULL ? new int(*p.height) : NULL;
+    }
+
+    preson(preson &&p) noexcept
+    {
+        age = p.age;
+        height = p.height;
+        p.height = NULL;
+    }
+
+    //先new再delete, new抛异常时自己保持原样
+    preson &operator=(const preson &p)
+    {
+        if (this != &p)
+        {
+            int *h = p.height != NULL ? new int(*p.height) : NULL;
+            delete height;
+            height = h;
+            age = p.age;
+        }
+        return *this;
+    }
+
+    preson &operator=(preson &&p) noexcept
+    {
+        if (this != &p)
+        {
+            delete height;
+            height = p.height;
+            age = p.age;
+            p.height = NULL;
+        }
+        return *this;
     }
 
     ~preson()
@@ -36,10 +81,16 @@ public:
             delete height;
             height = NULL;
         }
-        cout << "析构函数" << endl;
+        if (!quiet)
+        {
+            cout << "析构函数" << endl;
+        }
     }
 };
 
+bool preson::quiet = false;
+
+#ifndef PRESON_NO_MAIN
 void test01()
 {
     preson s1(10, 160);
@@ -48,10 +99,21 @@ void test01()
     cout << "身高是：" << *s1.height << endl;
 }
 
+void test02()
+{
+    preson s1(10, 160);
+    preson s2(std::move(s1));
+    cout << "移动以后：" << *s2.height << " 原来的：" << (s1.height == NULL ? "空" : "不空") << endl;
+    s1 = s2;
+    cout << "拷贝赋值：" << *s1.height << endl;
+}
+
 int main()
 {
     test01();
+    test02();
 
     system("pause");
     return 0;
-}
\ No newline at end of file
+}
+#endif
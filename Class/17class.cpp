@@ -0,0 +1,92 @@
+#include<iostream>
+#include<vector>
+#include<utility>
+#include<chrono>
+#include<new>
+#include<cstdlib>
+using namespace std;
+
+//移动语义的效果: vector<preson>不reserve一直push_back, 统计一共new了多少次
+//vector扩容时只有移动构造是noexcept的才会用移动, 否则为了异常安全还是逐个拷贝
+//小的数据(一个int)干脆直接存在对象里, 连new都不需要
+
+//统计全局new的次数, 用来对比
+static size_t allocCount = 0;
+
+void* operator new(size_t size)
+{
+    allocCount++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if(p == NULL)
+    {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+//preson就是Class/05里的那个(带noexcept移动), 这里只做统计
+#define PRESON_NO_MAIN
+#include "05shenkaobeiyuqiankaobei.cpp"
+
+//对照: 只声明拷贝构造, 编译器就不会生成移动构造, vector扩容时只能逐个深拷贝(和加移动之前一样)
+class copyOnlyPreson : public preson
+{
+public:
+    copyOnlyPreson(int a, int b) : preson(a, b) {}
+    copyOnlyPreson(const copyOnlyPreson& p) : preson(p) {}
+};
+
+//身高只是一个int, 直接存在对象里; 编译器生成的拷贝/移动/析构就都对了
+class compactPreson
+{
+public:
+    compactPreson(int a, int b) : age(a), height(b) {}
+
+    int age;
+    int height;
+};
+
+template<class T>
+void growVector(const char* name, int n)
+{
+    size_t before = allocCount;
+    auto t0 = chrono::steady_clock::now();
+    {
+        vector<T> v;
+        for(int i = 0; i<n; i++)
+        {
+            v.push_back(T(i % 100, 150 + i % 50));
+        }
+    }
+    auto t1 = chrono::steady_clock::now();
+    cout<<name<<": "<<allocCount - before<<" allocations, "
+        <<chrono::duration<double, milli>(t1 - t0).count()<<" ms"<<endl;
+}
+
+void test01()
+{
+    //不reserve, 让vector自己扩容
+    preson::quiet = true;
+    const int n = 1000000;
+    growVector<copyOnlyPreson>("copy only", n);
+    growVector<preson>("noexcept move", n);
+    growVector<compactPreson>("inline height", n);
+}
+
+int main()
+{
+    test01();
+
+    system("pause");
+    return 0;
+}
@@ -0,0 +1,643 @@
+#include<iostream>
+#include<vector>
+#include<string>
+#include<atomic>
+#include<algorithm>
+#include<thread>
+#include<chrono>
+#include<new>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<cstdint>
+#include<execinfo.h>
+#include<dlfcn.h>
+#include<cxxabi.h>
+using namespace std;
+
+//替换全局的operator new/delete, 按调用位置统计分配
+//调用位置 = operator new的返回地址, 也就是写new的那一行; 每次分配只做一次查表和几次普通加法,
+//开销很小, 可以放在线上灰度版本里跑. 这部分是精确的, 还记录了没释放的对象个数(可能是泄漏)
+//计数放在每个线程自己的计数块里(和Class/19的做法一样), 多个线程在同一个位置分配也不会抢同一个缓存行;
+//打印时把所有块加起来. 线程退出后它的块留给下一个新线程接着用, 块里的数照样算在总数里
+//在A线程分配、B线程释放时, B的块里live是负数, 加起来还是对的
+//string/vector的分配全都从标准库里同一个函数发出, 只看返回地址分不出是谁的, 所以另外按字节抽样:
+//每个线程每分配ALLOC_TRACKER_SAMPLE字节(默认256KB)取一次完整调用栈, 按调用栈汇总, 字节数是估算的
+//程序退出时两部分都按字节数排序打印
+//
+//单独用: g++ -g -rdynamic 18class.cpp
+//接到别的程序上: g++ -c -g -DALLOC_TRACKER_NO_MAIN 18class.cpp -o allocTracker.o
+//               g++ -g -rdynamic 10youyuanlei.cpp allocTracker.o
+//加-rdynamic函数名才能显示出来; 没有的话打印 模块+偏移, 用addr2line -f -C -e 程序 偏移 查
+//环境变量ALLOC_TRACKER_TOP控制打印前多少个位置(默认20), ALLOC_TRACKER_SAMPLE控制抽样间隔(字节, 0表示不抽样)
+//依赖glibc的backtrace和dladdr, 只能在Linux上用
+
+namespace allocTracker
+{
+    static const int MAX_SITES = 4096;
+    static const int MAX_FRAMES = 8;
+    //最后一个槽位给表满了以后的所有位置共用
+    static const uint32_t OVERFLOW_SITE = MAX_SITES - 1;
+
+    //表里只放位置本身, 插入以后就只读; 计数在下面的threadCounters里
+    struct site
+    {
+        atomic<uint64_t> key;
+        atomic<bool> ready;
+        void* frames[MAX_FRAMES];
+        int depth;
+    };
+
+    struct siteCounters
+    {
+        atomic<uint64_t> allocs;
+        atomic<uint64_t> bytes;
+        atomic<int64_t> liveCount;
+        atomic<int64_t> liveBytes;
+    };
+
+    //一个线程的计数块, 下标和siteTable的下标一一对应
+    //用calloc分配, 没碰过的页不占物理内存
+    struct threadCounters
+    {
+        siteCounters callers[MAX_SITES];
+        siteCounters stacks[MAX_SITES];
+        threadCounters* next;
+        atomic<bool> inUse;
+    };
+
+    //打印时合并出来的结果
+    struct siteTotals
+    {
+        uint64_t allocs;
+        uint64_t bytes;
+        int64_t liveCount;
+        int64_t liveBytes;
+    };
+
+    //一张按key(返回地址或者调用栈的哈希)查找的开放寻址表, 只插入不删除, 查找和插入都不加锁
+    struct siteTable
+    {
+        site sites[MAX_SITES];
+
+        //frames只在第一次插入时用来记录这个位置长什么样
+        uint32_t find(uint64_t key, void* const* frames, int depth)
+        {
+            uint32_t i = uint32_t((key * 0x9E3779B97F4A7C15ULL) >> 52) & (MAX_SITES - 1);
+            for(int probe = 0; probe<MAX_SITES; probe++, i = (i + 1) & (MAX_SITES - 1))
+            {
+                if(i == OVERFLOW_SITE)
+                {
+                    continue;
+                }
+                uint64_t k = sites[i].key.load(memory_order_acquire);
+                if(k == key)
+                {
+                    return i;
+                }
+                if(k == 0)
+                {
+                    uint64_t expected = 0;
+                    if(sites[i].key.compare_exchange_strong(expected, key, memory_order_acq_rel))
+                    {
+                        int d = min(depth, MAX_FRAMES);
+                        for(int f = 0; f<d; f++)
+                        {
+                            sites[i].frames[f] = frames[f];
+                        }
+                        sites[i].depth = d;
+                        sites[i].ready.store(true, memory_order_release);
+                        return i;
+                    }
+                    if(expected == key)
+                    {
+                        return i;
+                    }
+                }
+            }
+            return OVERFLOW_SITE;
+        }
+    };
+
+    //块前面的16字节: 大小、属于哪个位置、离malloc返回的地址有多远(对齐分配时用)
+    struct header
+    {
+        uint64_t size;
+        uint32_t site;
+        uint32_t offset;
+    };
+
+    static_assert(sizeof(header) == 16, "header must keep 16-byte alignment");
+
+    //静态数据全是零初始化, 不依赖任何构造函数, 在main之前的分配也能统计
+    static siteTable callers;
+    static siteTable stacks;
+    static atomic<bool> reporting(false);
+    static int64_t sampleInterval = 256 * 1024;
+    //backtrace自己也可能分配, 正在抽样时不再抽样, 防止递归
+    static thread_local bool inTracker = false;
+    static thread_local int64_t untilSample = 0;
+
+    //所有线程的计数块串成一个只增不减的链表
+    static atomic<threadCounters*> allBlocks(NULL);
+    //拿不到自己的块时(calloc失败, 或者线程已经在退出)用这个共用的块, 只有它用原子加法
+    static threadCounters sharedCounters;
+    static thread_local threadCounters* mine = NULL;
+    static thread_local bool retired = false;
+
+    //线程退出时把块还回去; 之后这个线程里再有分配就记到共用块上
+    struct threadRelease
+    {
+        ~threadRelease()
+        {
+            if(mine != NULL)
+            {
+                mine->inUse.store(false, memory_order_release);
+                mine = NULL;
+            }
+            retired = true;
+        }
+    };
+
+    static thread_local threadRelease releaser;
+
+    //先找一个退出的线程留下的块, 没有再新建一个
+    static threadCounters* acquireBlock()
+    {
+        for(threadCounters* b = allBlocks.load(memory_order_acquire); b != NULL; b = b->next)
+        {
+            bool expected = false;
+            if(!b->inUse.load(memory_order_relaxed) && b->inUse.compare_exchange_strong(expected, true, memory_order_acq_rel))
+            {
+                return b;
+            }
+        }
+        void* raw = calloc(1, sizeof(threadCounters));
+        if(raw == NULL)
+        {
+            return NULL;
+        }
+        threadCounters* b = new(raw) threadCounters;
+        b->inUse.store(true, memory_order_relaxed);
+        b->next = allBlocks.load(memory_order_relaxed);
+        while(!allBlocks.compare_exchange_weak(b->next, b, memory_order_acq_rel))
+        {
+        }
+        return b;
+    }
+
+    //owned为true表示块只有当前线程在写
+    static threadCounters* counters(bool& owned)
+    {
+        if(mine == NULL && !retired)
+        {
+            mine = acquireBlock();
+            //第一次用到releaser时才登记它的析构函数; 登记过程里再分配也能看到mine已经有值
+            (void)&releaser;
+        }
+        owned = mine != NULL;
+        return owned ? mine : &sharedCounters;
+    }
+
+    //自己的块用relaxed的load+store, 就是普通的加法指令; 共用块才用fetch_add
+    template<class T>
+    static void add(atomic<T>& a, T v, bool owned)
+    {
+        if(owned)
+        {
+            a.store(a.load(memory_order_relaxed) + v, memory_order_relaxed);
+        }
+        else
+        {
+            a.fetch_add(v, memory_order_relaxed);
+        }
+    }
+
+    static void sampleStack(size_t size, void* ret)
+    {
+        inTracker = true;
+        void* buf[MAX_FRAMES + 4];
+        int n = backtrace(buf, MAX_FRAMES + 4);
+        inTracker = false;
+        //前面几层是tracker自己和operator new(内联了几层看编译器), 从operator new的返回地址开始算
+        int first = 0;
+        while(first < n && buf[first] != ret)
+        {
+            first++;
+        }
+        if(first == n)
+        {
+            return;
+        }
+        uint64_t key = 0xCBF29CE484222325ULL;
+        for(int f = first; f<n; f++)
+        {
+            key = (key ^ uint64_t(reinterpret_cast<uintptr_t>(buf[f]))) * 0x100000001B3ULL;
+        }
+        uint32_t i = stacks.find(key | 1, buf + first, n - first);
+        bool owned;
+        siteCounters& c = counters(owned)->stacks[i];
+        add<uint64_t>(c.allocs, 1, owned);
+        //一次抽样代表sampleInterval字节, 对象比间隔还大时按实际大小算
+        add<uint64_t>(c.bytes, uint64_t(max<int64_t>(sampleInterval, int64_t(size))), owned);
+    }
+
+    static void* allocate(size_t size, size_t align, void* ret)
+    {
+        size_t pad = align > sizeof(header) ? align : sizeof(header);
+        char* raw = NULL;
+        if(align > alignof(max_align_t))
+        {
+            if(posix_memalign(reinterpret_cast<void**>(&raw), align, pad + size) != 0)
+            {
+                raw = NULL;
+            }
+        }
+        else
+        {
+            raw = static_cast<char*>(malloc(pad + size));
+        }
+        if(raw == NULL)
+        {
+            return NULL;
+        }
+        uint32_t s = OVERFLOW_SITE;
+        if(!reporting.load(memory_order_relaxed))
+        {
+            s = callers.find(uint64_t(reinterpret_cast<uintptr_t>(ret)), &ret, 1);
+            bool owned;
+            siteCounters& c = counters(owned)->callers[s];
+            add<uint64_t>(c.allocs, 1, owned);
+            add<uint64_t>(c.bytes, size, owned);
+            add<int64_t>(c.liveCount, 1, owned);
+            add<int64_t>(c.liveBytes, int64_t(size), owned);
+            if(sampleInterval > 0 && !inTracker && (untilSample -= int64_t(size)) <= 0)
+            {
+                untilSample += sampleInterval;
+                sampleStack(size, ret);
+            }
+        }
+        header* h = reinterpret_cast<header*>(raw + pad) - 1;
+        h->size = size;
+        h->site = s;
+        h->offset = uint32_t(pad);
+        return raw + pad;
+    }
+
+    static void release(void* p)
+    {
+        if(p == NULL)
+        {
+            return;
+        }
+        header* h = static_cast<header*>(p) - 1;
+        bool owned;
+        siteCounters& c = counters(owned)->callers[h->site];
+        add<int64_t>(c.liveCount, -1, owned);
+        add<int64_t>(c.liveBytes, -int64_t(h->size), owned);
+        free(static_cast<char*>(p) - h->offset);
+    }
+
+    static void* allocateOrThrow(size_t size, size_t align, void* ret)
+    {
+        void* p = allocate(size, align, ret);
+        while(p == NULL)
+        {
+            new_handler handler = get_new_handler();
+            if(handler == NULL)
+            {
+                throw bad_alloc();
+            }
+            handler();
+            p = allocate(size, align, ret);
+        }
+        return p;
+    }
+
+    //nothrow版本也要走new_handler, handler抛出bad_alloc时返回NULL
+    static void* allocateNoThrow(size_t size, size_t align, void* ret) noexcept
+    {
+        try
+        {
+            return allocateOrThrow(size, align, ret);
+        }
+        catch(...)
+        {
+            return NULL;
+        }
+    }
+
+    static void printFrame(void* addr)
+    {
+        Dl_info info;
+        if(dladdr(addr, &info) != 0 && info.dli_sname != NULL)
+        {
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+            fprintf(stderr, "      %s+0x%lx\n", status == 0 ? demangled : info.dli_sname,
+                    (unsigned long)(static_cast<char*>(addr) - static_cast<char*>(info.dli_saddr)));
+            free(demangled);
+        }
+        else if(dladdr(addr, &info) != 0)
+        {
+            fprintf(stderr, "      %s+0x%lx\n", info.dli_fname,
+                    (unsigned long)(static_cast<char*>(addr) - static_cast<char*>(info.dli_fbase)));
+        }
+        else
+        {
+            fprintf(stderr, "      %p\n", addr);
+        }
+    }
+
+    //把所有线程的块(加上共用块)加起来
+    static void mergeCounters(bool callerCounts, siteTotals* out)
+    {
+        memset(out, 0, sizeof(siteTotals) * MAX_SITES);
+        threadCounters* b = &sharedCounters;
+        threadCounters* next = allBlocks.load(memory_order_acquire);
+        while(b != NULL)
+        {
+            const siteCounters* c = callerCounts ? b->callers : b->stacks;
+            for(int i = 0; i<MAX_SITES; i++)
+            {
+                out[i].allocs += c[i].allocs.load(memory_order_relaxed);
+                out[i].bytes += c[i].bytes.load(memory_order_relaxed);
+                out[i].liveCount += c[i].liveCount.load(memory_order_relaxed);
+                out[i].liveBytes += c[i].liveBytes.load(memory_order_relaxed);
+            }
+            b = next;
+            next = b != NULL ? b->next : NULL;
+        }
+    }
+
+    static void printTable(siteTable& table, const siteTotals* t, int top, bool exact)
+    {
+        static uint32_t order[MAX_SITES];
+        int n = 0;
+        uint64_t totalAllocs = 0;
+        uint64_t totalBytes = 0;
+        for(int i = 0; i<MAX_SITES; i++)
+        {
+            if(t[i].allocs > 0)
+            {
+                order[n++] = uint32_t(i);
+                totalAllocs += t[i].allocs;
+                totalBytes += t[i].bytes;
+            }
+        }
+        sort(order, order + n, [t](uint32_t a, uint32_t b)
+        {
+            return t[a].bytes > t[b].bytes;
+        });
+        if(exact)
+        {
+            fprintf(stderr, "allocations by caller: %llu allocations, %llu bytes, %d call sites\n",
+                    (unsigned long long)totalAllocs, (unsigned long long)totalBytes, n);
+        }
+        else
+        {
+            fprintf(stderr, "allocations by stack (sampled every %lld bytes): %llu samples, ~%llu bytes, %d stacks\n",
+                    (long long)sampleInterval, (unsigned long long)totalAllocs, (unsigned long long)totalBytes, n);
+        }
+        for(int k = 0; k<n && k<top; k++)
+        {
+            const siteTotals& c = t[order[k]];
+            site& s = table.sites[order[k]];
+            if(exact)
+            {
+                fprintf(stderr, "  #%d  allocs %llu  bytes %llu  live %lld objects / %lld bytes\n", k + 1,
+                        (unsigned long long)c.allocs, (unsigned long long)c.bytes,
+                        (long long)c.liveCount, (long long)c.liveBytes);
+            }
+            else
+            {
+                fprintf(stderr, "  #%d  samples %llu  ~bytes %llu\n", k + 1,
+                        (unsigned long long)c.allocs, (unsigned long long)c.bytes);
+            }
+            if(order[k] == OVERFLOW_SITE)
+            {
+                fprintf(stderr, "      (other call sites, table full)\n");
+                continue;
+            }
+            if(!s.ready.load(memory_order_acquire))
+            {
+                continue;
+            }
+            for(int f = 0; f<s.depth; f++)
+            {
+                printFrame(s.frames[f]);
+            }
+        }
+    }
+
+    //退出时打印, 用fprintf不用cout, 这时cout可能已经析构了
+    void report()
+    {
+        reporting.store(true, memory_order_relaxed);
+        int top = 20;
+        const char* env = getenv("ALLOC_TRACKER_TOP");
+        if(env != NULL)
+        {
+            top = atoi(env);
+        }
+        static siteTotals totals[MAX_SITES];
+        mergeCounters(true, totals);
+        printTable(callers, totals, top, true);
+        if(sampleInterval > 0)
+        {
+            mergeCounters(false, totals);
+            printTable(stacks, totals, top, false);
+        }
+    }
+
+    //先调一次backtrace, 让它把要用的库在main之前加载好
+    struct installer
+    {
+        installer()
+        {
+            const char* env = getenv("ALLOC_TRACKER_SAMPLE");
+            if(env != NULL)
+            {
+                sampleInterval = atoll(env);
+            }
+            void* buf[2];
+            inTracker = true;
+            backtrace(buf, 2);
+            inTracker = false;
+            atexit(report);
+        }
+    };
+
+    static installer install;
+}
+
+//noinline: 定义在同一个文件里时编译器会把operator new内联到调用者, 返回地址就变成调用者的调用者了
+//delete也一样, 内联以后编译器会对块头的指针运算报越界警告
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    return allocTracker::allocateOrThrow(size, 0, __builtin_return_address(0));
+}
+
+__attribute__((noinline)) void* operator new[](size_t size)
+{
+    return allocTracker::allocateOrThrow(size, 0, __builtin_return_address(0));
+}
+
+__attribute__((noinline)) void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    return allocTracker::allocateNoThrow(size, 0, __builtin_return_address(0));
+}
+
+__attribute__((noinline)) void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+    return allocTracker::allocateNoThrow(size, 0, __builtin_return_address(0));
+}
+
+__attribute__((noinline)) void* operator new(size_t size, align_val_t align)
+{
+    return allocTracker::allocateOrThrow(size, size_t(align), __builtin_return_address(0));
+}
+
+__attribute__((noinline)) void* operator new[](size_t size, align_val_t align)
+{
+    return allocTracker::allocateOrThrow(size, size_t(align), __builtin_return_address(0));
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { allocTracker::release(p); }
+__attribute__((noinline)) void operator delete[](void* p) noexcept { allocTracker::release(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { allocTracker::release(p); }
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept { allocTracker::release(p); }
+__attribute__((noinline)) void operator delete(void* p, align_val_t) noexcept { allocTracker::release(p); }
+__attribute__((noinline)) void operator delete[](void* p, align_val_t) noexcept { allocTracker::release(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t, align_val_t) noexcept { allocTracker::release(p); }
+__attribute__((noinline)) void operator delete[](void* p, size_t, align_val_t) noexcept { allocTracker::release(p); }
+
+#ifndef ALLOC_TRACKER_NO_MAIN
+class building
+{
+public:
+    building()
+    {
+        bu_sittingroom = "客厅, 一个比较长的名字, 放不进string内部的缓冲区";
+        bu_bedroom = "卧室, 一个比较长的名字, 放不进string内部的缓冲区";
+    }
+
+    string bu_sittingroom;
+    string bu_bedroom;
+};
+
+class preson
+{
+public:
+    preson(int a, int b)
+    {
+        age = a;
+        height = new int(b);
+    }
+
+    ~preson()
+    {
+        delete height;
+    }
+
+    int age;
+    int* height;
+};
+
+//-O2下编译器可以把成对的new/delete直接删掉, 让指针"逃出去", 分配就一定会发生
+static void keep(void* p)
+{
+    asm volatile("" : : "g"(p) : "memory");
+}
+
+struct alignas(64) cacheLine
+{
+    char data[64];
+};
+
+void test01()
+{
+    //每次都new一个building, 用完就删
+    for(int i = 0; i<1000; i++)
+    {
+        building* b = new building;
+        delete b;
+    }
+
+    //vector不reserve, 扩容时反复分配
+    vector<string> names;
+    for(int i = 0; i<10000; i++)
+    {
+        names.push_back("preson_with_a_long_name_" + to_string(i));
+    }
+
+    //故意不释放, 报告里会显示为live
+    for(int i = 0; i<3; i++)
+    {
+        preson* p = new preson(10, 160);
+        keep(p);
+    }
+
+    cacheLine* c = new cacheLine[4];
+    delete[] c;
+}
+
+//几个线程在同一行new/delete; 再在一个线程里分配、另一个线程里释放
+void test02()
+{
+    const int threads = 4;
+    const int n = 500000;
+    auto t0 = chrono::steady_clock::now();
+    vector<thread> ws;
+    vector<long long> sums(threads);
+    for(int t = 0; t<threads; t++)
+    {
+        ws.push_back(thread([&sums, t]()
+        {
+            for(int i = 0; i<n; i++)
+            {
+                preson* p = new preson(i, 150);
+                keep(p);
+                sums[t] += *p->height + p->age;
+                delete p;
+            }
+        }));
+    }
+    for(size_t t = 0; t<ws.size(); t++)
+    {
+        ws[t].join();
+    }
+    auto t1 = chrono::steady_clock::now();
+
+    vector<preson*> handoff;
+    thread producer([&handoff]()
+    {
+        for(int i = 0; i<1000; i++)
+        {
+            handoff.push_back(new preson(i, 150));
+        }
+    });
+    producer.join();
+    thread consumer([&handoff]()
+    {
+        for(size_t i = 0; i<handoff.size(); i++)
+        {
+            delete handoff[i];
+        }
+    });
+    consumer.join();
+
+    cout<<threads<<" threads x "<<n<<" new/delete: "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms (sum "
+        <<sums[0] + sums[1] + sums[2] + sums[3]<<")"<<endl;
+    cout<<"done, report follows on stderr"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+
+    system("pause");
+    return 0;
+}
+#endif
@@ -0,0 +1,407 @@
+#include<iostream>
+#include<vector>
+#include<string>
+#include<map>
+#include<mutex>
+#include<thread>
+#include<atomic>
+#include<typeinfo>
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#ifdef __GNUG__
+#include<cxxabi.h>
+#endif
+using namespace std;
+
+//用CRTP统计一个类的对象被构造、拷贝、移动、赋值、析构了多少次
+//class preson : public lifecycle_counted<preson> { ... };
+//不用在每个构造函数里打印, 热循环里不小心发生的拷贝也能直接看到次数
+//计数放在每个线程自己的计数块里, 只有自己的线程写, 不需要原子加法; 报告时把所有线程的块加起来
+//线程退出时把块还给登记表, 之后新建的线程接着用它(计数照样保留), 线程再多块的个数也只和同时在跑的线程数有关
+//注意: 派生类自己写了拷贝构造却没有调用基类的拷贝构造时, 基类走的是普通构造, 会记成"构造"
+
+enum lifecycleEvent
+{
+    LC_CONSTRUCT,
+    LC_COPY,
+    LC_MOVE,
+    LC_COPY_ASSIGN,
+    LC_MOVE_ASSIGN,
+    LC_DESTROY,
+    LC_EVENTS
+};
+
+static const char* lifecycleNames[LC_EVENTS] = {"constructed", "copied", "moved", "copy-assigned", "move-assigned", "destroyed"};
+
+struct lifecycleCounts
+{
+    uint64_t n[LC_EVENTS] = {};
+
+    uint64_t alive() const
+    {
+        return n[LC_CONSTRUCT] + n[LC_COPY] + n[LC_MOVE] - n[LC_DESTROY];
+    }
+};
+
+//一个线程对一个类型的计数块. 只有所属线程会写, 用relaxed的load+store代替fetch_add,
+//生成的就是普通的加一指令, 报告线程读的时候也不算数据竞争
+//inUse为false表示原来的线程已经退出, 可以给新线程用
+struct lifecycleBlock
+{
+    atomic<uint64_t> n[LC_EVENTS];
+    atomic<bool> inUse;
+
+    lifecycleBlock() : inUse(true)
+    {
+        for(int e = 0; e<LC_EVENTS; e++)
+        {
+            n[e].store(0, memory_order_relaxed);
+        }
+    }
+
+    void bump(lifecycleEvent e)
+    {
+        n[e].store(n[e].load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+    //线程退出以后还有对象析构时记到共用块上, 只有它用原子加法
+    void bumpShared(lifecycleEvent e)
+    {
+        n[e].fetch_add(1, memory_order_relaxed);
+    }
+};
+
+class lifecycleRegistry
+{
+public:
+    static lifecycleRegistry& get()
+    {
+        static lifecycleRegistry r;
+        return r;
+    }
+
+    ~lifecycleRegistry()
+    {
+        for(map<string, vector<lifecycleBlock*>>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+        {
+            for(size_t i = 0; i<it->second.size(); i++)
+            {
+                delete it->second[i];
+            }
+        }
+    }
+
+    //先找这个类型里已经退出的线程留下的块, 没有再新建; 旧的计数留在块里, 总数不变
+    lifecycleBlock* acquireBlock(const char* type)
+    {
+        lock_guard<mutex> g(lock);
+        vector<lifecycleBlock*>& list = blocks[type];
+        for(size_t i = 0; i<list.size(); i++)
+        {
+            if(!list[i]->inUse.load(memory_order_acquire))
+            {
+                list[i]->inUse.store(true, memory_order_relaxed);
+                return list[i];
+            }
+        }
+        list.push_back(new lifecycleBlock());
+        return list.back();
+    }
+
+    //线程退出时调用; release和acquireBlock里的acquire配对, 新线程能看到旧线程最后写的计数
+    void releaseBlock(lifecycleBlock* b)
+    {
+        b->inUse.store(false, memory_order_release);
+    }
+
+    //每个类型一个共用块, 永远标记为使用中, 不会被分给线程
+    lifecycleBlock* sharedBlock(const char* type)
+    {
+        lock_guard<mutex> g(lock);
+        lifecycleBlock*& b = shared[type];
+        if(b == NULL)
+        {
+            b = new lifecycleBlock();
+            blocks[type].push_back(b);
+        }
+        return b;
+    }
+
+    size_t blockCount()
+    {
+        lock_guard<mutex> g(lock);
+        size_t n = 0;
+        for(map<string, vector<lifecycleBlock*>>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+        {
+            n += it->second.size();
+        }
+        return n;
+    }
+
+    map<string, lifecycleCounts> totals()
+    {
+        map<string, lifecycleCounts> out;
+        lock_guard<mutex> g(lock);
+        for(map<string, vector<lifecycleBlock*>>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+        {
+            lifecycleCounts& c = out[it->first];
+            for(size_t i = 0; i<it->second.size(); i++)
+            {
+                for(int e = 0; e<LC_EVENTS; e++)
+                {
+                    c.n[e] += it->second[i]->n[e].load(memory_order_relaxed);
+                }
+            }
+        }
+        return out;
+    }
+
+    void report()
+    {
+        map<string, lifecycleCounts> t = totals();
+        printf("%-12s", "type");
+        for(int e = 0; e<LC_EVENTS; e++)
+        {
+            printf(" %14s", lifecycleNames[e]);
+        }
+        printf(" %14s\n", "alive");
+        for(map<string, lifecycleCounts>::iterator it = t.begin(); it != t.end(); ++it)
+        {
+            printf("%-12s", it->first.c_str());
+            for(int e = 0; e<LC_EVENTS; e++)
+            {
+                printf(" %14llu", (unsigned long long)it->second.n[e]);
+            }
+            printf(" %14llu\n", (unsigned long long)it->second.alive());
+        }
+    }
+
+private:
+    mutex lock;
+    map<string, vector<lifecycleBlock*>> blocks;
+    map<string, lifecycleBlock*> shared;
+};
+
+template<class T>
+string lifecycleTypeName()
+{
+#ifdef __GNUG__
+    int status = 0;
+    char* s = abi::__cxa_demangle(typeid(T).name(), NULL, NULL, &status);
+    string name = status == 0 ? s : typeid(T).name();
+    free(s);
+    return name;
+#else
+    return typeid(T).name();
+#endif
+}
+
+template<class T>
+class lifecycle_counted
+{
+public:
+    static lifecycleCounts counts()
+    {
+        return lifecycleRegistry::get().totals()[typeName()];
+    }
+
+protected:
+    lifecycle_counted() { bump(LC_CONSTRUCT); }
+    lifecycle_counted(const lifecycle_counted&) { bump(LC_COPY); }
+    lifecycle_counted(lifecycle_counted&&) noexcept { bump(LC_MOVE); }
+
+    lifecycle_counted& operator=(const lifecycle_counted&)
+    {
+        bump(LC_COPY_ASSIGN);
+        return *this;
+    }
+
+    lifecycle_counted& operator=(lifecycle_counted&&) noexcept
+    {
+        bump(LC_MOVE_ASSIGN);
+        return *this;
+    }
+
+    ~lifecycle_counted() { bump(LC_DESTROY); }
+
+private:
+    static const string& typeName()
+    {
+        static const string name = lifecycleTypeName<T>();
+        return name;
+    }
+
+    //和Class/18class.cpp一样: 线程第一次用时借一个块, 线程退出时releaser把块还回去
+    //还回去以后这个线程里再有对象析构(比如别的thread_local对象), 记到共用块上
+    static void bump(lifecycleEvent e)
+    {
+        thread_local lifecycleBlock* mine = NULL;
+        thread_local bool retired = false;
+        struct blockRelease
+        {
+            ~blockRelease()
+            {
+                if(mine != NULL)
+                {
+                    lifecycleRegistry::get().releaseBlock(mine);
+                    mine = NULL;
+                }
+                retired = true;
+            }
+        };
+        thread_local blockRelease releaser;
+
+        if(mine == NULL && !retired)
+        {
+            mine = lifecycleRegistry::get().acquireBlock(typeName().c_str());
+            (void)&releaser;
+        }
+        if(mine != NULL)
+        {
+            mine->bump(e);
+        }
+        else
+        {
+            lifecycleRegistry::get().sharedBlock(typeName().c_str())->bumpShared(e);
+        }
+    }
+};
+
+//量一段代码: 构造时记下当前的计数, 析构时打印这段代码里T发生了什么
+template<class T>
+class lifecycleScope
+{
+public:
+    explicit lifecycleScope(const char* n) : name(n), before(T::counts()) {}
+
+    ~lifecycleScope()
+    {
+        lifecycleCounts after = T::counts();
+        cout<<name<<":";
+        for(int e = 0; e<LC_EVENTS; e++)
+        {
+            if(after.n[e] != before.n[e])
+            {
+                cout<<" "<<lifecycleNames[e]<<" "<<after.n[e] - before.n[e];
+            }
+        }
+        cout<<endl;
+    }
+
+private:
+    const char* name;
+    lifecycleCounts before;
+};
+
+class preson : public lifecycle_counted<preson>
+{
+public:
+    preson() : age(0) {}
+    preson(int a, string n) : age(a), name(n) {}
+
+    int age;
+    string name;
+};
+
+class ani : public lifecycle_counted<ani>
+{
+public:
+    virtual ~ani() {}
+};
+
+class dog : public ani, public lifecycle_counted<dog>
+{
+public:
+    using lifecycle_counted<dog>::counts;
+};
+
+int sumAges(vector<preson> v)
+{
+    int s = 0;
+    for(size_t i = 0; i<v.size(); i++)
+    {
+        s += v[i].age;
+    }
+    return s;
+}
+
+void test01()
+{
+    vector<preson> v;
+    {
+        lifecycleScope<preson> scope("push_back 1000 without reserve");
+        for(int i = 0; i<1000; i++)
+        {
+            v.push_back(preson(i % 100, "preson"));
+        }
+    }
+    long long total = 0;
+    {
+        lifecycleScope<preson> scope("for(preson p : v)");
+        for(preson p : v)
+        {
+            total += p.age;
+        }
+    }
+    {
+        lifecycleScope<preson> scope("for(const preson& p : v)");
+        for(const preson& p : v)
+        {
+            total += p.age;
+        }
+    }
+    {
+        lifecycleScope<preson> scope("sumAges(v) by value");
+        total += sumAges(v);
+    }
+    {
+        lifecycleScope<preson> scope("v[0] = v[1]; v[2] = move(v[3])");
+        v[0] = v[1];
+        v[2] = std::move(v[3]);
+    }
+    cout<<"total "<<total<<endl;
+
+    //多个线程各自计数, 报告时汇总
+    vector<thread> ws;
+    for(int t = 0; t<4; t++)
+    {
+        ws.push_back(thread([]()
+        {
+            for(int i = 0; i<1000; i++)
+            {
+                dog d;
+                dog copy(d);
+                (void)copy;
+            }
+        }));
+    }
+    for(size_t t = 0; t<ws.size(); t++)
+    {
+        ws[t].join();
+    }
+    cout<<"dogs copied: "<<dog::counts().n[LC_COPY]<<endl;
+
+    //很多短命的线程: 块被重复使用, 个数不会跟着线程数涨
+    size_t before = lifecycleRegistry::get().blockCount();
+    for(int t = 0; t<200; t++)
+    {
+        thread([]()
+        {
+            dog d;
+            preson p(1, "preson");
+        }).join();
+    }
+    cout<<"200 short threads: "<<lifecycleRegistry::get().blockCount() - before<<" new blocks, dogs constructed "
+        <<dog::counts().n[LC_CONSTRUCT]<<endl;
+
+    lifecycleRegistry::get().report();
+}
+
+int main()
+{
+    test01();
+
+    system("pause");
+    return 0;
+}
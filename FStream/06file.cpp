@@ -0,0 +1,496 @@
+#include<iostream>
+#include<fstream>
+#include<string>
+#include<string_view>
+#include<vector>
+#include<stdexcept>
+#include<type_traits>
+#include<chrono>
+#include<cstring>
+#include<cstdio>
+#include<cstdint>
+#include<cerrno>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+using namespace std;
+
+//文件本身就是vector的存储: 用mmap把文件映射进内存, 元素直接读写映射区
+//下次启动重新映射同一个文件, 数据马上就能用, 不需要再解析文本
+//只适合能按字节拷贝的结构体(trivially copyable), string这种带指针的放到旁边的blob文件里, 结构体只存偏移和长度
+//扩容: ftruncate把文件变大, Linux上用mremap扩大映射(可能换地址, 之前拿到的指针和引用都会失效)
+//sync()用msync把脏页写回磁盘, 只有调用过sync()的数据才保证断电不丢
+//只能在POSIX系统上编译(Linux/macOS), macOS没有mremap, 用munmap再mmap代替
+
+//一个可以变大的映射文件, 开头留一个固定的文件头
+class mappedFile
+{
+public:
+    mappedFile() : fd(-1), base(NULL), bytes(0) {}
+
+    ~mappedFile()
+    {
+        close();
+    }
+
+    mappedFile(const mappedFile&) = delete;
+    mappedFile& operator=(const mappedFile&) = delete;
+
+    //返回true表示文件是新建的(或者原来是空的)
+    //已有的文件小于minBytes(比如放不下文件头)时抛异常, 不去映射它
+    bool open(const string& path, size_t initialBytes, size_t minBytes = 0)
+    {
+        close();
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if(fd < 0)
+        {
+            throw runtime_error("cannot open " + path + ": " + strerror(errno));
+        }
+        struct stat st;
+        if(fstat(fd, &st) != 0)
+        {
+            int err = errno;
+            close();
+            throw runtime_error("cannot stat " + path + ": " + strerror(err));
+        }
+        bool fresh = st.st_size == 0;
+        if(!fresh && size_t(st.st_size) < minBytes)
+        {
+            close();
+            throw runtime_error(path + " is too small (" + to_string(st.st_size) + " bytes)");
+        }
+        bytes = fresh ? initialBytes : size_t(st.st_size);
+        if(fresh && ftruncate(fd, off_t(bytes)) != 0)
+        {
+            throw runtime_error("cannot resize " + path + ": " + strerror(errno));
+        }
+        base = static_cast<char*>(mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        if(base == MAP_FAILED)
+        {
+            base = NULL;
+            throw runtime_error("cannot map " + path + ": " + strerror(errno));
+        }
+        return fresh;
+    }
+
+    void grow(size_t newBytes)
+    {
+        if(newBytes <= bytes)
+        {
+            return;
+        }
+        if(ftruncate(fd, off_t(newBytes)) != 0)
+        {
+            throw runtime_error(string("cannot grow file: ") + strerror(errno));
+        }
+#ifdef __linux__
+        void* p = mremap(base, bytes, newBytes, MREMAP_MAYMOVE);
+#else
+        munmap(base, bytes);
+        void* p = mmap(NULL, newBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+#endif
+        if(p == MAP_FAILED)
+        {
+            throw runtime_error(string("cannot remap file: ") + strerror(errno));
+        }
+        base = static_cast<char*>(p);
+        bytes = newBytes;
+    }
+
+    void sync()
+    {
+        if(base != NULL && msync(base, bytes, MS_SYNC) != 0)
+        {
+            throw runtime_error(string("msync failed: ") + strerror(errno));
+        }
+    }
+
+    void close()
+    {
+        if(base != NULL)
+        {
+            munmap(base, bytes);
+            base = NULL;
+        }
+        if(fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        bytes = 0;
+    }
+
+    char* data() { return base; }
+    size_t size() const { return bytes; }
+
+private:
+    int fd;
+    char* base;
+    size_t bytes;
+};
+
+struct fileHeader
+{
+    uint64_t magic;
+    uint64_t recordSize;    //打开时核对, 结构体改过以后不会把旧文件当新格式读
+    uint64_t count;
+    uint64_t capacity;
+};
+
+static const uint64_t VECTOR_MAGIC = 0x31524556534E5250ULL;   //"PRNSVER1"
+static const uint64_t BLOB_MAGIC = 0x31424F4C42534E50ULL;     //"PNSBLOB1"
+
+template<class T>
+class persistentVector
+{
+    static_assert(is_trivially_copyable<T>::value, "persistentVector needs trivially copyable records");
+
+public:
+    //容量至少是1, 不然push_back时翻倍还是0
+    explicit persistentVector(const string& path, size_t initialCapacity = 1024)
+    {
+        initialCapacity = max(initialCapacity, size_t(1));
+        bool fresh = file.open(path, sizeof(fileHeader) + initialCapacity * sizeof(T), sizeof(fileHeader));
+        if(fresh)
+        {
+            header()->magic = VECTOR_MAGIC;
+            header()->recordSize = sizeof(T);
+            header()->count = 0;
+            header()->capacity = initialCapacity;
+        }
+        else if(header()->magic != VECTOR_MAGIC || header()->recordSize != sizeof(T))
+        {
+            throw runtime_error(path + " is not a persistentVector of this record type");
+        }
+        //文件头里的容量和个数要和文件实际大小对得上, 截断过的文件不能用
+        else if(header()->capacity == 0 || header()->capacity > (file.size() - sizeof(fileHeader)) / sizeof(T)
+                || header()->count > header()->capacity)
+        {
+            throw runtime_error(path + " is truncated or corrupt");
+        }
+    }
+
+    size_t size() const { return size_t(header()->count); }
+    size_t capacity() const { return size_t(header()->capacity); }
+
+    T& operator[](size_t i) { return records()[i]; }
+    const T& operator[](size_t i) const { return records()[i]; }
+    T* begin() { return records(); }
+    T* end() { return records() + size(); }
+
+    void reserve(size_t n)
+    {
+        if(n > capacity())
+        {
+            file.grow(sizeof(fileHeader) + n * sizeof(T));
+            header()->capacity = n;
+        }
+    }
+
+    void push_back(const T& v)
+    {
+        if(size() == capacity())
+        {
+            //v可能指向映射区, 扩容后地址会变, 先拷出来
+            T tmp = v;
+            reserve(capacity() * 2);
+            records()[size()] = tmp;
+        }
+        else
+        {
+            records()[size()] = v;
+        }
+        //先写数据再改个数, 中途崩溃最多丢掉这一条
+        header()->count++;
+    }
+
+    void clear()
+    {
+        header()->count = 0;
+    }
+
+    void sync()
+    {
+        file.sync();
+    }
+
+private:
+    fileHeader* header() { return reinterpret_cast<fileHeader*>(file.data()); }
+    const fileHeader* header() const { return reinterpret_cast<const fileHeader*>(const_cast<mappedFile&>(file).data()); }
+    T* records() { return reinterpret_cast<T*>(file.data() + sizeof(fileHeader)); }
+    const T* records() const { return reinterpret_cast<const T*>(const_cast<mappedFile&>(file).data() + sizeof(fileHeader)); }
+
+    mappedFile file;
+};
+
+//字符串在blob文件里的位置
+struct blobRef
+{
+    uint64_t offset;
+    uint64_t length;
+};
+
+//只追加的字符串仓库, header的count记录已经用掉的字节数
+class stringBlob
+{
+public:
+    explicit stringBlob(const string& path, size_t initialBytes = 1 << 16)
+    {
+        initialBytes = max(initialBytes, size_t(1));
+        bool fresh = file.open(path, sizeof(fileHeader) + initialBytes, sizeof(fileHeader));
+        if(fresh)
+        {
+            header()->magic = BLOB_MAGIC;
+            header()->recordSize = 1;
+            header()->count = 0;
+            header()->capacity = initialBytes;
+        }
+        else if(header()->magic != BLOB_MAGIC)
+        {
+            throw runtime_error(path + " is not a stringBlob");
+        }
+        else if(header()->capacity == 0 || header()->capacity > file.size() - sizeof(fileHeader)
+                || header()->count > header()->capacity)
+        {
+            throw runtime_error(path + " is truncated or corrupt");
+        }
+    }
+
+    blobRef append(string_view s)
+    {
+        uint64_t used = header()->count;
+        if(used + s.size() > header()->capacity)
+        {
+            uint64_t cap = header()->capacity;
+            while(used + s.size() > cap)
+            {
+                cap *= 2;
+            }
+            file.grow(sizeof(fileHeader) + cap);
+            header()->capacity = cap;
+        }
+        memcpy(file.data() + sizeof(fileHeader) + used, s.data(), s.size());
+        header()->count = used + s.size();
+        blobRef r = {used, s.size()};
+        return r;
+    }
+
+    //返回的string_view指向映射区, blob扩容以后就失效了
+    //记录文件和blob文件不配套(blob被截断或者是旧的)时, 引用可能超出已用的部分, 报错而不是越界读
+    string_view get(blobRef r)
+    {
+        uint64_t used = header()->count;
+        if(r.offset > used || r.length > used - r.offset)
+        {
+            throw runtime_error("blob reference out of range");
+        }
+        return string_view(file.data() + sizeof(fileHeader) + r.offset, size_t(r.length));
+    }
+
+    void clear()
+    {
+        header()->count = 0;
+    }
+
+    void sync()
+    {
+        file.sync();
+    }
+
+private:
+    fileHeader* header() { return reinterpret_cast<fileHeader*>(file.data()); }
+
+    mappedFile file;
+};
+
+//每条记录在磁盘上的样子: 名字在blob里, 年龄直接存
+struct presonRecord
+{
+    blobRef name;
+    int32_t age;
+};
+
+//一张人员表 = 定长记录文件 + 名字blob文件
+class presonTable
+{
+public:
+    explicit presonTable(const string& path) : records(path + ".dat"), names(path + ".blob") {}
+
+    void add(string_view name, int age)
+    {
+        presonRecord r;
+        r.name = names.append(name);
+        r.age = age;
+        records.push_back(r);
+    }
+
+    size_t size() const { return records.size(); }
+    string_view name(size_t i) { return names.get(records[i].name); }
+    int age(size_t i) const { return records[i].age; }
+
+    void clear()
+    {
+        records.clear();
+        names.clear();
+    }
+
+    //先写名字再写记录, 这样已经落盘的记录引用的名字一定也已经落盘
+    void sync()
+    {
+        names.sync();
+        records.sync();
+    }
+
+private:
+    persistentVector<presonRecord> records;
+    stringBlob names;
+};
+
+class preson
+{
+public:
+    preson(string name, int age)
+    {
+        this->pr_name = name;
+        this->pr_age = age;
+    }
+
+    string pr_name;
+    int pr_age;
+};
+
+void test01()
+{
+    {
+        presonTable table("presons");
+        table.clear();
+        table.add("zhangsan", 10);
+        table.add("lisi"    , 10);
+        table.add("wangwun" , 30);
+        table.add("zhaoliu" , 60);
+        table.add("caoqi"   , 90);
+        table.sync();
+    }
+
+    //重新打开, 不用解析直接读
+    presonTable table("presons");
+    for(size_t i = 0; i<table.size(); i++)
+    {
+        cout<<"the name is:"<<table.name(i)<<" the age is:"<<table.age(i)<<endl;
+    }
+
+    //容量给0也能正常追加; 上一次运行留下的是截断过的tiny.dat, 先删掉
+    remove("tiny.dat");
+    {
+        persistentVector<int32_t> tiny("tiny.dat", 0);
+        tiny.clear();
+        for(int32_t i = 0; i<5; i++)
+        {
+            tiny.push_back(i);
+        }
+        cout<<"tiny: size "<<tiny.size()<<" capacity "<<tiny.capacity()<<endl;
+    }
+
+    //放不下文件头的文件、别的格式的文件、被截断的文件都报错, 不会越界读
+    {
+        ofstream ofs("broken.dat", ios::out | ios::trunc | ios::binary);
+        ofs<<"abc";
+    }
+    {
+        ofstream ofs("foreign.dat", ios::out | ios::trunc | ios::binary);
+        ofs<<string(64, 'x');
+    }
+    if(truncate("tiny.dat", off_t(sizeof(fileHeader) + 2 * sizeof(int32_t))) != 0)
+    {
+        cout<<"cannot truncate tiny.dat"<<endl;
+    }
+    const char* bad[] = {"broken.dat", "foreign.dat", "tiny.dat"};
+    for(int i = 0; i<3; i++)
+    {
+        try
+        {
+            persistentVector<int32_t> v(bad[i]);
+            cout<<bad[i]<<" opened?!"<<endl;
+        }
+        catch(const runtime_error& e)
+        {
+            cout<<"error: "<<e.what()<<endl;
+        }
+    }
+
+    //记录还在, 名字blob却被清空了: 读名字时报错
+    {
+        presonTable stale("stale");
+        stale.clear();
+        stale.add("zhangsan", 10);
+        stale.sync();
+    }
+    {
+        stringBlob names("stale.blob");
+        names.clear();
+        names.sync();
+    }
+    try
+    {
+        presonTable stale("stale");
+        string_view name = stale.name(0);
+        cout<<"stale name: "<<name<<endl;
+    }
+    catch(const runtime_error& e)
+    {
+        cout<<"error: "<<e.what()<<endl;
+    }
+}
+
+void test02()
+{
+    const int n = 2000000;
+    {
+        ofstream ofs("presons_big.txt", ios::out | ios::trunc);
+        presonTable table("presons_big");
+        table.clear();
+        for(int i = 0; i<n; i++)
+        {
+            string name = "preson_" + to_string(i);
+            ofs<<name<<" "<<i % 100<<"\n";
+            table.add(name, i % 100);
+        }
+        table.sync();
+    }
+
+    //以前的做法: 每次启动从文本重新建立vector<preson>
+    auto t0 = chrono::steady_clock::now();
+    vector<preson> v;
+    ifstream ifs("presons_big.txt", ios::in);
+    string name;
+    int age;
+    while(ifs>>name>>age)
+    {
+        v.push_back(preson(name, age));
+    }
+    auto t1 = chrono::steady_clock::now();
+
+    //映射文件: 打开就能用
+    presonTable table("presons_big");
+    auto t2 = chrono::steady_clock::now();
+    long long sum = 0;
+    for(size_t i = 0; i<table.size(); i++)
+    {
+        sum += table.age(i);
+    }
+    auto t3 = chrono::steady_clock::now();
+
+    cout<<n<<" presons: parse text "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms, reopen mapped table "
+        <<chrono::duration<double, milli>(t2 - t1).count()<<" ms (scan all ages "
+        <<chrono::duration<double, milli>(t3 - t2).count()<<" ms), "
+        <<(v.size() == table.size() && table.name(n - 1) == v.back().pr_name ? "same" : "DIFFERENT")<<", sum "<<sum<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+
+    system("pause");
+}
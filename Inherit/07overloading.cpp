@@ -4,12 +4,31 @@ using namespace std;
 class Box
 {
 public:
-    Box(){};
+    Box()
+    {
+        length = NULL;
+    };
     Box(double a)
     {
         length = new double(a);
 
     }
+    //默认的拷贝和赋值只拷贝指针, 两个Box析构时会delete同一块内存
+    Box(const Box& b)
+    {
+        length = b.length != NULL ? new double(*b.length) : NULL;
+    }
+    Box(Box&& b) noexcept
+    {
+        length = b.length;
+        b.length = NULL;
+    }
+    //按值传参: 左值拷贝一份, 右值直接移动, 再交换
+    Box& operator=(Box b) noexcept
+    {
+        swap(length, b.length);
+        return *this;
+    }
 
     ~Box()
     {
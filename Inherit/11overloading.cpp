@@ -0,0 +1,388 @@
+#include<iostream>
+#include<vector>
+#include<stdexcept>
+#include<type_traits>
+#include<chrono>
+#include<cstddef>
+using namespace std;
+
+//表达式模板(expression templates)
+//Box::operator+每次返回一个新Box, a+b+c+d要产生三个中间结果; 换成一组Box时每个+都要把整个数组走一遍再分配一次
+//这里operator+不做计算, 只返回一个记住两边操作数的小对象(表达式树)
+//真正赋值给Box或boxArray时才按下标一次算完整棵树: 一个循环, 没有中间数组, 编译器可以向量化
+//单个Box可以和数组混着用, 这时它对每个元素都一样(广播)
+
+//所有表达式的基类, E是具体的表达式类型
+//get<C>(i)返回第i个盒子的第C个分量(0长 1宽 2高), size()返回元素个数
+//scalar为true表示整个表达式只是一个Box, 对任何i都返回同一个值, 可以广播; 只有一个元素的boxArray不算
+template<class E>
+class boxExpr
+{
+public:
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+class Box;
+class boxArray;
+
+//boxArray按引用保存; Box只有三个double, 和中间表达式一样按值保存
+//所以auto e = Box(1, 2, 3) + a;里的临时Box不会悬空, 但a本身要活得比e长
+template<class E>
+struct exprStorage
+{
+    typedef const E type;
+};
+
+template<>
+struct exprStorage<boxArray>
+{
+    typedef const boxArray& type;
+};
+
+//两个操作数的大小要么一样, 要么有一个是单个Box
+template<class L, class R>
+size_t broadcastSize(const L& l, const R& r)
+{
+    if(L::scalar)
+    {
+        return r.size();
+    }
+    if(R::scalar)
+    {
+        return l.size();
+    }
+    if(l.size() != r.size())
+    {
+        throw length_error("box arrays of different sizes");
+    }
+    return l.size();
+}
+
+template<class L, class R, class Op>
+class boxBinary : public boxExpr<boxBinary<L, R, Op>>
+{
+public:
+    static const bool scalar = L::scalar && R::scalar;
+
+    boxBinary(const L& l, const R& r) : lhs(l), rhs(r), n(broadcastSize(l, r)) {}
+
+    template<int C>
+    double get(size_t i) const
+    {
+        return Op::apply(lhs.template get<C>(i), rhs.template get<C>(i));
+    }
+
+    size_t size() const { return n; }
+
+private:
+    typename exprStorage<L>::type lhs;
+    typename exprStorage<R>::type rhs;
+    size_t n;
+};
+
+template<class E>
+class boxScaled : public boxExpr<boxScaled<E>>
+{
+public:
+    static const bool scalar = E::scalar;
+
+    boxScaled(const E& e, double k) : expr(e), factor(k) {}
+
+    template<int C>
+    double get(size_t i) const
+    {
+        return expr.template get<C>(i) * factor;
+    }
+
+    size_t size() const { return expr.size(); }
+
+private:
+    typename exprStorage<E>::type expr;
+    double factor;
+};
+
+struct addOp
+{
+    static double apply(double a, double b) { return a + b; }
+};
+
+struct subOp
+{
+    static double apply(double a, double b) { return a - b; }
+};
+
+template<class L, class R>
+boxBinary<L, R, addOp> operator+(const boxExpr<L>& a, const boxExpr<R>& b)
+{
+    return boxBinary<L, R, addOp>(a.self(), b.self());
+}
+
+template<class L, class R>
+boxBinary<L, R, subOp> operator-(const boxExpr<L>& a, const boxExpr<R>& b)
+{
+    return boxBinary<L, R, subOp>(a.self(), b.self());
+}
+
+template<class E>
+boxScaled<E> operator*(const boxExpr<E>& a, double k)
+{
+    return boxScaled<E>(a.self(), k);
+}
+
+template<class E>
+boxScaled<E> operator*(double k, const boxExpr<E>& a)
+{
+    return boxScaled<E>(a.self(), k);
+}
+
+class Box : public boxExpr<Box>
+{
+public:
+    static const bool scalar = true;
+
+    Box(double l = 0, double w = 0, double h = 0) : length(l), width(w), height(h) {}
+
+    template<class E>
+    Box(const boxExpr<E>& e)
+    {
+        assign(e.self());
+    }
+
+    template<class E>
+    Box& operator=(const boxExpr<E>& e)
+    {
+        assign(e.self());
+        return *this;
+    }
+
+    template<int C>
+    double get(size_t) const
+    {
+        return C == 0 ? length : (C == 1 ? width : height);
+    }
+
+    size_t size() const { return 1; }
+
+    double getvolume() const
+    {
+        return length * width * height;
+    }
+
+    double length;
+    double width;
+    double height;
+
+private:
+    //先全部算完再写, 表达式里用到自己(box = box + other)也没问题
+    //只有全是单个Box的表达式才能变成Box; 含有boxArray的要赋给boxArray
+    template<class E>
+    void assign(const E& e)
+    {
+        static_assert(E::scalar, "only expressions made of single Boxes can be assigned to a Box, use boxArray");
+        double l = e.template get<0>(0);
+        double w = e.template get<1>(0);
+        double h = e.template get<2>(0);
+        length = l;
+        width = w;
+        height = h;
+    }
+};
+
+//一组盒子, 长宽高分别连续存放, 循环里每个分量都是连续访问
+class boxArray : public boxExpr<boxArray>
+{
+public:
+    static const bool scalar = false;
+
+    explicit boxArray(size_t n = 0) : lengths(n), widths(n), heights(n) {}
+
+    template<class E>
+    boxArray(const boxExpr<E>& e)
+    {
+        assign(e.self());
+    }
+
+    template<class E>
+    boxArray& operator=(const boxExpr<E>& e)
+    {
+        assign(e.self());
+        return *this;
+    }
+
+    template<class E>
+    boxArray& operator+=(const boxExpr<E>& e)
+    {
+        assign(*this + e.self());
+        return *this;
+    }
+
+    template<int C>
+    double get(size_t i) const
+    {
+        return C == 0 ? lengths[i] : (C == 1 ? widths[i] : heights[i]);
+    }
+
+    size_t size() const { return lengths.size(); }
+
+    void set(size_t i, const Box& b)
+    {
+        lengths[i] = b.length;
+        widths[i] = b.width;
+        heights[i] = b.height;
+    }
+
+    Box operator[](size_t i) const
+    {
+        return Box(lengths[i], widths[i], heights[i]);
+    }
+
+private:
+    //每个分量一个循环, 循环体就是整棵表达式树展开后的几次加法, 没有分支
+    //第i个元素只依赖各操作数的第i个元素, 所以a = a + b这种原地更新也是对的
+    template<class E>
+    void assign(const E& e)
+    {
+        size_t n = e.size();
+        lengths.resize(n);
+        widths.resize(n);
+        heights.resize(n);
+        fill<0>(lengths.data(), e, n);
+        fill<1>(widths.data(), e, n);
+        fill<2>(heights.data(), e, n);
+    }
+
+    template<int C, class E>
+    static void fill(double* out, const E& e, size_t n)
+    {
+        for(size_t i = 0; i<n; i++)
+        {
+            out[i] = e.template get<C>(i);
+        }
+    }
+
+    vector<double> lengths;
+    vector<double> widths;
+    vector<double> heights;
+};
+
+//对照: 原来的写法, 每个+返回一个新数组
+class eagerBoxArray
+{
+public:
+    explicit eagerBoxArray(size_t n = 0) : boxes(n) {}
+
+    eagerBoxArray operator+(const eagerBoxArray& a) const
+    {
+        eagerBoxArray r(boxes.size());
+        for(size_t i = 0; i<boxes.size(); i++)
+        {
+            r.boxes[i].length = boxes[i].length + a.boxes[i].length;
+            r.boxes[i].width = boxes[i].width + a.boxes[i].width;
+            r.boxes[i].height = boxes[i].height + a.boxes[i].height;
+        }
+        return r;
+    }
+
+    vector<Box> boxes;
+};
+
+void test01()
+{
+    Box box1(10, 12, 10);
+    Box box2(10, 12, 10);
+    Box box3(1, 2, 3);
+
+    Box box4 = box1 + box2 + box3;
+    cout<<"box4's volume is:"<<box4.getvolume()<<endl;
+    box4 = (box4 - box3) * 0.5;
+    cout<<"after (box4 - box3) * 0.5: "<<box4.length<<" "<<box4.width<<" "<<box4.height<<endl;
+
+    boxArray a(4);
+    boxArray b(4);
+    for(size_t i = 0; i<4; i++)
+    {
+        a.set(i, Box(i + 1, i + 1, i + 1));
+        b.set(i, Box(1, 2, 3));
+    }
+    //单个Box加到每个元素上
+    boxArray c = a + b + box3;
+    c += 2 * a;
+    for(size_t i = 0; i<c.size(); i++)
+    {
+        cout<<"c["<<i<<"] = "<<c[i].length<<" "<<c[i].width<<" "<<c[i].height<<endl;
+    }
+
+    try
+    {
+        boxArray d = a + boxArray(3);
+    }
+    catch(const length_error& e)
+    {
+        cout<<"error: "<<e.what()<<endl;
+    }
+
+    //只有一个元素的boxArray不会被广播
+    try
+    {
+        boxArray d = boxArray(1) + a;
+    }
+    catch(const length_error& e)
+    {
+        cout<<"boxArray(1) + a: "<<e.what()<<endl;
+    }
+
+    //表达式里的临时Box按值保存, 先存进auto再求值也没问题
+    auto e = Box(1, 2, 3) + a;
+    boxArray f = e;
+    cout<<"f[3] = "<<f[3].length<<" "<<f[3].width<<" "<<f[3].height<<endl;
+}
+
+void test02()
+{
+    const size_t n = 1000000;
+    const int reps = 20;
+    boxArray a(n), b(n), c(n), d(n);
+    eagerBoxArray ea(n), eb(n), ec(n), ed(n);
+    for(size_t i = 0; i<n; i++)
+    {
+        Box x(i % 7, i % 11, i % 13);
+        a.set(i, x);
+        b.set(i, x);
+        c.set(i, x);
+        d.set(i, x);
+        ea.boxes[i] = x;
+        eb.boxes[i] = x;
+        ec.boxes[i] = x;
+        ed.boxes[i] = x;
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    eagerBoxArray er;
+    for(int r = 0; r<reps; r++)
+    {
+        er = ea + eb + ec + ed;
+    }
+    auto t1 = chrono::steady_clock::now();
+    boxArray lr;
+    for(int r = 0; r<reps; r++)
+    {
+        lr = a + b + c + d;
+    }
+    auto t2 = chrono::steady_clock::now();
+
+    bool same = true;
+    for(size_t i = 0; i<n; i++)
+    {
+        same = same && er.boxes[i].height == lr[i].height;
+    }
+    cout<<"a+b+c+d over "<<n<<" boxes x"<<reps<<": temporaries "<<chrono::duration<double, milli>(t1 - t0).count()
+        <<" ms, expression template "<<chrono::duration<double, milli>(t2 - t1).count()<<" ms ("
+        <<(same ? "same" : "DIFFERENT")<<")"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+    system("pause");
+}
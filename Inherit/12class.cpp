@@ -0,0 +1,382 @@
+#include<iostream>
+#include<vector>
+#include<chrono>
+#include<stdexcept>
+#include<cstdint>
+#include<cstddef>
+#if defined(__x86_64__) || defined(__i386__)
+#include<immintrin.h>
+#define BOX_X86 1
+#endif
+using namespace std;
+
+//一次算很多个盒子的体积和表面积
+//BoxBatch把长、宽、高分成三个数组存(structure of arrays), 一条AVX2指令同时处理4个盒子
+//第一次用的时候检查CPU支不支持AVX2, 不支持就用标量版本
+//filter_by_volume: 体积大于阈值的盒子下标; compare_volumes: 逐个比较两批盒子, 相当于Box的operator>
+
+class Box
+{
+public:
+    Box(double a = 0, double b = 0, double c = 0) : length(a), width(b), height(c) {}
+
+    double getvolume() const
+    {
+        return length * width * height;
+    }
+
+    double length;
+    double width;
+    double height;
+};
+
+//----------------标量版本----------------
+
+static void volumesScalar(const double* l, const double* w, const double* h, double* out, size_t n)
+{
+    for(size_t i = 0; i<n; i++)
+    {
+        out[i] = l[i] * w[i] * h[i];
+    }
+}
+
+static void surfaceAreasScalar(const double* l, const double* w, const double* h, double* out, size_t n)
+{
+    for(size_t i = 0; i<n; i++)
+    {
+        out[i] = 2 * (l[i] * w[i] + w[i] * h[i] + h[i] * l[i]);
+    }
+}
+
+static size_t filterScalar(const double* l, const double* w, const double* h, size_t n, double minVolume, uint32_t* out)
+{
+    size_t k = 0;
+    for(size_t i = 0; i<n; i++)
+    {
+        //不用if, 先写再决定要不要前进, 避免分支预测失败
+        out[k] = uint32_t(i);
+        k += l[i] * w[i] * h[i] > minVolume ? 1 : 0;
+    }
+    return k;
+}
+
+static void compareScalar(const double* l1, const double* w1, const double* h1,
+                          const double* l2, const double* w2, const double* h2, uint8_t* out, size_t n)
+{
+    for(size_t i = 0; i<n; i++)
+    {
+        out[i] = l1[i] * w1[i] * h1[i] > l2[i] * w2[i] * h2[i] ? 1 : 0;
+    }
+}
+
+//----------------AVX2版本----------------
+
+#ifdef BOX_X86
+__attribute__((target("avx2")))
+static void volumesAvx2(const double* l, const double* w, const double* h, double* out, size_t n)
+{
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d v = _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(l + i), _mm256_loadu_pd(w + i)), _mm256_loadu_pd(h + i));
+        _mm256_storeu_pd(out + i, v);
+    }
+    volumesScalar(l + i, w + i, h + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void surfaceAreasAvx2(const double* l, const double* w, const double* h, double* out, size_t n)
+{
+    const __m256d two = _mm256_set1_pd(2);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d a = _mm256_loadu_pd(l + i);
+        __m256d b = _mm256_loadu_pd(w + i);
+        __m256d c = _mm256_loadu_pd(h + i);
+        __m256d s = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a, b), _mm256_mul_pd(b, c)), _mm256_mul_pd(c, a));
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(two, s));
+    }
+    surfaceAreasScalar(l + i, w + i, h + i, out + i, n - i);
+}
+
+//比较结果用movemask变成4位掩码, 再按位取出下标
+__attribute__((target("avx2")))
+static size_t filterAvx2(const double* l, const double* w, const double* h, size_t n, double minVolume, uint32_t* out)
+{
+    const __m256d limit = _mm256_set1_pd(minVolume);
+    size_t k = 0;
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d v = _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(l + i), _mm256_loadu_pd(w + i)), _mm256_loadu_pd(h + i));
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(v, limit, _CMP_GT_OQ));
+        while(mask != 0)
+        {
+            out[k++] = uint32_t(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+    for(; i<n; i++)
+    {
+        out[k] = uint32_t(i);
+        k += l[i] * w[i] * h[i] > minVolume ? 1 : 0;
+    }
+    return k;
+}
+
+__attribute__((target("avx2")))
+static void compareAvx2(const double* l1, const double* w1, const double* h1,
+                        const double* l2, const double* w2, const double* h2, uint8_t* out, size_t n)
+{
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d a = _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(l1 + i), _mm256_loadu_pd(w1 + i)), _mm256_loadu_pd(h1 + i));
+        __m256d b = _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(l2 + i), _mm256_loadu_pd(w2 + i)), _mm256_loadu_pd(h2 + i));
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GT_OQ));
+        out[i] = uint8_t(mask & 1);
+        out[i + 1] = uint8_t((mask >> 1) & 1);
+        out[i + 2] = uint8_t((mask >> 2) & 1);
+        out[i + 3] = uint8_t((mask >> 3) & 1);
+    }
+    compareScalar(l1 + i, w1 + i, h1 + i, l2 + i, w2 + i, h2 + i, out + i, n - i);
+}
+#endif
+
+//----------------运行时选择----------------
+//和STL/23numeric.cpp、STL/19set.cpp是同一套做法(函数指针表 + 第一次用时__builtin_cpu_supports检查)
+//每个文件都要能单独编译, 所以这里是复制的一份; 改检测条件(比如加上fma或AVX-512)时几个文件要一起改
+
+struct boxKernels
+{
+    void (*volumes)(const double*, const double*, const double*, double*, size_t);
+    void (*surfaceAreas)(const double*, const double*, const double*, double*, size_t);
+    size_t (*filter)(const double*, const double*, const double*, size_t, double, uint32_t*);
+    void (*compare)(const double*, const double*, const double*, const double*, const double*, const double*, uint8_t*, size_t);
+    const char* name;
+};
+
+static const boxKernels scalarKernels = { volumesScalar, surfaceAreasScalar, filterScalar, compareScalar, "scalar" };
+
+static boxKernels pickKernels()
+{
+    boxKernels k = scalarKernels;
+#ifdef BOX_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        k.volumes = volumesAvx2;
+        k.surfaceAreas = surfaceAreasAvx2;
+        k.filter = filterAvx2;
+        k.compare = compareAvx2;
+        k.name = "avx2";
+    }
+#endif
+    return k;
+}
+
+static const boxKernels& kernels()
+{
+    static boxKernels k = pickKernels();
+    return k;
+}
+
+//----------------BoxBatch----------------
+
+class BoxBatch
+{
+public:
+    BoxBatch() : use(&kernels()) {}
+
+    //测试用: 强制用标量版本
+    void forceScalar() { use = &scalarKernels; }
+    const char* kernelName() const { return use->name; }
+
+    void reserve(size_t n)
+    {
+        lengths.reserve(n);
+        widths.reserve(n);
+        heights.reserve(n);
+    }
+
+    void push_back(const Box& b)
+    {
+        lengths.push_back(b.length);
+        widths.push_back(b.width);
+        heights.push_back(b.height);
+    }
+
+    size_t size() const { return lengths.size(); }
+
+    Box operator[](size_t i) const
+    {
+        return Box(lengths[i], widths[i], heights[i]);
+    }
+
+    //out至少要有size()个位置; 每帧都算的话反复用同一个out, 不用每次分配
+    void volumes(double* out) const
+    {
+        use->volumes(lengths.data(), widths.data(), heights.data(), out, size());
+    }
+
+    vector<double> volumes() const
+    {
+        vector<double> out(size());
+        volumes(out.data());
+        return out;
+    }
+
+    void surface_areas(double* out) const
+    {
+        use->surfaceAreas(lengths.data(), widths.data(), heights.data(), out, size());
+    }
+
+    vector<double> surface_areas() const
+    {
+        vector<double> out(size());
+        surface_areas(out.data());
+        return out;
+    }
+
+    //体积大于minVolume的盒子的下标, 从小到大
+    vector<uint32_t> filter_by_volume(double minVolume) const
+    {
+        vector<uint32_t> out(size() + 1);
+        out.resize(use->filter(lengths.data(), widths.data(), heights.data(), size(), minVolume, out.data()));
+        return out;
+    }
+
+    //第i位为1表示this的第i个盒子比other的第i个大, 两批大小不一样时抛length_error
+    vector<uint8_t> compare_volumes(const BoxBatch& other) const
+    {
+        if(other.size() != size())
+        {
+            throw length_error("box batches of different sizes");
+        }
+        vector<uint8_t> out(size());
+        use->compare(lengths.data(), widths.data(), heights.data(),
+                     other.lengths.data(), other.widths.data(), other.heights.data(), out.data(), size());
+        return out;
+    }
+
+private:
+    vector<double> lengths;
+    vector<double> widths;
+    vector<double> heights;
+    const boxKernels* use;
+};
+
+void test01()
+{
+    BoxBatch batch;
+    batch.push_back(Box(10, 12, 10));
+    batch.push_back(Box(1, 2, 3));
+    batch.push_back(Box(5, 5, 5));
+    batch.push_back(Box(2, 2, 2));
+    batch.push_back(Box(7, 1, 9));
+    cout<<"kernels: "<<batch.kernelName()<<endl;
+
+    vector<double> v = batch.volumes();
+    vector<double> s = batch.surface_areas();
+    for(size_t i = 0; i<batch.size(); i++)
+    {
+        cout<<"box"<<i<<"'s volume is:"<<v[i]<<" surface area is:"<<s[i]<<endl;
+    }
+
+    vector<uint32_t> big = batch.filter_by_volume(60);
+    cout<<"volume > 60:";
+    for(size_t i = 0; i<big.size(); i++)
+    {
+        cout<<" box"<<big[i];
+    }
+    cout<<endl;
+
+    BoxBatch other;
+    for(size_t i = 0; i<batch.size(); i++)
+    {
+        other.push_back(Box(4, 4, 4));
+    }
+    vector<uint8_t> bigger = batch.compare_volumes(other);
+    for(size_t i = 0; i<bigger.size(); i++)
+    {
+        cout<<"box"<<i<<(bigger[i] ? " is bigger" : " is not bigger")<<" than 4x4x4"<<endl;
+    }
+
+    //少一个盒子的一批不能拿来比
+    other.push_back(Box(4, 4, 4));
+    try
+    {
+        batch.compare_volumes(other);
+    }
+    catch(const length_error& e)
+    {
+        cout<<"error: "<<e.what()<<endl;
+    }
+}
+
+void test02()
+{
+    const size_t n = 4000000;
+    const int reps = 10;
+    vector<Box> boxes;
+    BoxBatch batch;
+    BoxBatch other;
+    boxes.reserve(n);
+    batch.reserve(n);
+    other.reserve(n);
+    for(size_t i = 0; i<n; i++)
+    {
+        Box b(1 + i % 7, 1 + i % 11, 1 + i % 13);
+        boxes.push_back(b);
+        batch.push_back(b);
+        other.push_back(Box(1 + i % 5, 1 + i % 9, 1 + i % 17));
+    }
+    BoxBatch scalar = batch;
+    scalar.forceScalar();
+    vector<double> out(n);
+
+    auto t0 = chrono::steady_clock::now();
+    for(int r = 0; r<reps; r++)
+    {
+        for(size_t i = 0; i<n; i++)
+        {
+            out[i] = boxes[i].getvolume();
+        }
+    }
+    auto t1 = chrono::steady_clock::now();
+    for(int r = 0; r<reps; r++)
+    {
+        scalar.volumes(out.data());
+    }
+    auto t2 = chrono::steady_clock::now();
+    for(int r = 0; r<reps; r++)
+    {
+        batch.volumes(out.data());
+    }
+    auto t3 = chrono::steady_clock::now();
+    cout<<"volumes of "<<n<<" boxes x"<<reps<<": vector<Box> "<<chrono::duration<double, milli>(t1 - t0).count()
+        <<" ms, BoxBatch scalar "<<chrono::duration<double, milli>(t2 - t1).count()
+        <<" ms, BoxBatch "<<batch.kernelName()<<" "<<chrono::duration<double, milli>(t3 - t2).count()<<" ms"<<endl;
+
+    auto t4 = chrono::steady_clock::now();
+    size_t a = scalar.filter_by_volume(500).size();
+    auto t5 = chrono::steady_clock::now();
+    size_t b = batch.filter_by_volume(500).size();
+    auto t6 = chrono::steady_clock::now();
+    vector<uint8_t> c1 = scalar.compare_volumes(other);
+    auto t7 = chrono::steady_clock::now();
+    vector<uint8_t> c2 = batch.compare_volumes(other);
+    auto t8 = chrono::steady_clock::now();
+    cout<<"filter_by_volume: scalar "<<chrono::duration<double, milli>(t5 - t4).count()<<" ms, "<<batch.kernelName()<<" "
+        <<chrono::duration<double, milli>(t6 - t5).count()<<" ms ("<<(a == b ? "same" : "DIFFERENT")<<")"<<endl;
+    cout<<"compare_volumes: scalar "<<chrono::duration<double, milli>(t7 - t6).count()<<" ms, "<<batch.kernelName()<<" "
+        <<chrono::duration<double, milli>(t8 - t7).count()<<" ms ("<<(c1 == c2 ? "same" : "DIFFERENT")<<")"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+    system("pause");
+}
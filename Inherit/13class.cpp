@@ -0,0 +1,737 @@
+#include<iostream>
+#include<vector>
+#include<memory>
+#include<future>
+#include<thread>
+#include<algorithm>
+#include<chrono>
+#include<random>
+#include<cstdint>
+#include<cmath>
+#include<cfloat>
+using namespace std;
+
+//包围盒层次结构(BVH): 几十万个盒子里找和某个盒子重叠的、包含某个点的、被一条射线打到的
+//AABB继承shape, 在长宽高之外加上中心点位置
+//建树: 每层按表面积启发式(SAH)选划分位置, 先把图元的中心分到12个桶里, 只在桶的边界上试, 不用排序
+//      图元多的子树交给另一个线程去建(std::async), 各线程只改自己那一段, 互不干扰
+//建完以后展开成一个数组: 左孩子紧跟在父节点后面, 只存右孩子的下标, 每个节点32字节, 两个节点一条缓存行
+//盒子移动以后不重建, 只把包围盒沿着父节点往上更新(refit), 树的结构不变, 移动不大时查询效率基本不变
+
+class shape
+{
+public:
+    shape(float a = 0, float b = 0, float c = 0) : length(a), width(b), height(c) {}
+
+    void setLenght(float L) { length = L; }
+    void setWidth(float W) { width = W; }
+    void setHeight(float H) { height = H; }
+
+    float getVolume() const
+    {
+        return length * width * height;
+    }
+
+protected:
+    float length;
+    float width;
+    float height;
+};
+
+//min/max表示的包围盒
+struct bounds
+{
+    float lo[3];
+    float hi[3];
+
+    static bounds empty()
+    {
+        bounds b = {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+        return b;
+    }
+
+    void grow(const bounds& o)
+    {
+        for(int k = 0; k<3; k++)
+        {
+            lo[k] = min(lo[k], o.lo[k]);
+            hi[k] = max(hi[k], o.hi[k]);
+        }
+    }
+
+    void grow(const float* p)
+    {
+        for(int k = 0; k<3; k++)
+        {
+            lo[k] = min(lo[k], p[k]);
+            hi[k] = max(hi[k], p[k]);
+        }
+    }
+
+    float surfaceArea() const
+    {
+        float dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+        if(dx < 0 || dy < 0 || dz < 0)
+        {
+            return 0;
+        }
+        return 2 * (dx * dy + dy * dz + dz * dx);
+    }
+
+    bool overlaps(const bounds& o) const
+    {
+        return lo[0] <= o.hi[0] && hi[0] >= o.lo[0] && lo[1] <= o.hi[1] && hi[1] >= o.lo[1]
+            && lo[2] <= o.hi[2] && hi[2] >= o.lo[2];
+    }
+
+    bool contains(const float* p) const
+    {
+        return lo[0] <= p[0] && p[0] <= hi[0] && lo[1] <= p[1] && p[1] <= hi[1] && lo[2] <= p[2] && p[2] <= hi[2];
+    }
+
+    bool operator==(const bounds& o) const
+    {
+        for(int k = 0; k<3; k++)
+        {
+            if(lo[k] != o.lo[k] || hi[k] != o.hi[k])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+class AABB : public shape
+{
+public:
+    AABB(float x = 0, float y = 0, float z = 0, float l = 0, float w = 0, float h = 0) : shape(l, w, h)
+    {
+        setPosition(x, y, z);
+    }
+
+    void setPosition(float x, float y, float z)
+    {
+        center[0] = x;
+        center[1] = y;
+        center[2] = z;
+    }
+
+    bounds box() const
+    {
+        bounds b = {{center[0] - length / 2, center[1] - width / 2, center[2] - height / 2},
+                    {center[0] + length / 2, center[1] + width / 2, center[2] + height / 2}};
+        return b;
+    }
+
+    float center[3];
+};
+
+struct ray
+{
+    float origin[3];
+    float dir[3];
+};
+
+//射线和包围盒求交(slab方法), 返回进入的距离, 打不到返回FLT_MAX
+inline float rayEnter(const bounds& b, const float* origin, const float* invDir, float tMax)
+{
+    float t0 = 0, t1 = tMax;
+    for(int k = 0; k<3; k++)
+    {
+        float a = (b.lo[k] - origin[k]) * invDir[k];
+        float c = (b.hi[k] - origin[k]) * invDir[k];
+        t0 = max(t0, min(a, c));
+        t1 = min(t1, max(a, c));
+    }
+    return t0 <= t1 ? t0 : FLT_MAX;
+}
+
+class bvh
+{
+public:
+    static const int BINS = 12;
+    static const uint32_t MAX_LEAF = 8;
+    //图元少于这个数的子树不再开新线程
+    static const uint32_t PARALLEL_MIN = 32768;
+
+    struct node
+    {
+        bounds b;
+        uint32_t index;     //叶子: 第一个图元的位置; 内部节点: 右孩子的下标(左孩子就是下一个)
+        uint16_t count;     //0表示内部节点
+        uint16_t axis;      //划分的轴, 射线查询时决定先走哪边
+    };
+
+    static_assert(sizeof(node) == 32, "two nodes per cache line");
+
+    void build(const vector<AABB>& items, bool parallel = true)
+    {
+        size_t n = items.size();
+        prims.resize(n);
+        vector<primRef> refs(n);
+        for(size_t i = 0; i<n; i++)
+        {
+            refs[i].b = items[i].box();
+            for(int k = 0; k<3; k++)
+            {
+                refs[i].c[k] = (refs[i].b.lo[k] + refs[i].b.hi[k]) / 2;
+            }
+            refs[i].id = uint32_t(i);
+        }
+        int depth = parallel ? int(log2(max(1u, thread::hardware_concurrency()))) + 1 : 0;
+        nodes.clear();
+        if(n == 0)
+        {
+            return;
+        }
+        unique_ptr<buildNode> root = buildRange(refs, 0, uint32_t(n), depth);
+
+        nodes.reserve(2 * n / MAX_LEAF + 1);
+        parents.clear();
+        maxDepth = 0;
+        flatten(root.get(), UINT32_MAX, 1);
+        slotOf.resize(n);
+        leafOf.resize(n);
+        ids.resize(n);
+        for(size_t k = 0; k<n; k++)
+        {
+            prims[k] = refs[k].b;
+            ids[k] = refs[k].id;
+            slotOf[refs[k].id] = uint32_t(k);
+        }
+        for(uint32_t i = 0; i<nodes.size(); i++)
+        {
+            for(uint32_t k = 0; k<nodes[i].count; k++)
+            {
+                leafOf[ids[nodes[i].index + k]] = i;
+            }
+        }
+    }
+
+    size_t nodeCount() const { return nodes.size(); }
+
+    //所有和q重叠的盒子
+    void overlapping(const bounds& q, vector<uint32_t>& out) const
+    {
+        out.clear();
+        if(nodes.empty())
+        {
+            return;
+        }
+        traversalStack st(maxDepth);
+        uint32_t* stack = st.data;
+        int top = 0;
+        stack[top++] = 0;
+        while(top > 0)
+        {
+            const node& nd = nodes[stack[--top]];
+            if(!nd.b.overlaps(q))
+            {
+                continue;
+            }
+            if(nd.count > 0)
+            {
+                for(uint32_t k = nd.index; k<nd.index + nd.count; k++)
+                {
+                    if(prims[k].overlaps(q))
+                    {
+                        out.push_back(ids[k]);
+                    }
+                }
+            }
+            else
+            {
+                stack[top++] = nd.index;
+                stack[top++] = uint32_t(&nd - &nodes[0]) + 1;
+            }
+        }
+    }
+
+    //所有包含点p的盒子
+    void containing(const float* p, vector<uint32_t>& out) const
+    {
+        bounds q = {{p[0], p[1], p[2]}, {p[0], p[1], p[2]}};
+        overlapping(q, out);
+    }
+
+    //射线最先打到的盒子, 没有返回-1
+    int raycast(const ray& r, float& tHit) const
+    {
+        int best = -1;
+        tHit = FLT_MAX;
+        if(nodes.empty())
+        {
+            return best;
+        }
+        float inv[3];
+        for(int k = 0; k<3; k++)
+        {
+            inv[k] = 1.0f / r.dir[k];
+        }
+        traversalStack st(maxDepth);
+        uint32_t* stack = st.data;
+        int top = 0;
+        stack[top++] = 0;
+        while(top > 0)
+        {
+            uint32_t i = stack[--top];
+            const node& nd = nodes[i];
+            if(rayEnter(nd.b, r.origin, inv, tHit) == FLT_MAX)
+            {
+                continue;
+            }
+            if(nd.count > 0)
+            {
+                for(uint32_t k = nd.index; k<nd.index + nd.count; k++)
+                {
+                    float t = rayEnter(prims[k], r.origin, inv, tHit);
+                    if(t < tHit)
+                    {
+                        tHit = t;
+                        best = int(ids[k]);
+                    }
+                }
+            }
+            else
+            {
+                //射线沿这个轴的正方向走时左边(坐标小的一边)先被打到, 后入栈先处理
+                if(r.dir[nd.axis] >= 0)
+                {
+                    stack[top++] = nd.index;
+                    stack[top++] = i + 1;
+                }
+                else
+                {
+                    stack[top++] = i + 1;
+                    stack[top++] = nd.index;
+                }
+            }
+        }
+        return best;
+    }
+
+    //一个盒子移动了: 更新它自己, 再沿父节点往上重新算包围盒, 哪一层没变化就停
+    void move(uint32_t id, const AABB& item)
+    {
+        prims[slotOf[id]] = item.box();
+        uint32_t i = leafOf[id];
+        while(i != UINT32_MAX)
+        {
+            bounds b = recompute(i);
+            if(b == nodes[i].b)
+            {
+                break;
+            }
+            nodes[i].b = b;
+            i = parents[i];
+        }
+    }
+
+    //很多盒子都动了的时候整棵树一起更新: 孩子的下标总比父节点大, 倒着走一遍就行
+    void refit()
+    {
+        for(size_t i = nodes.size(); i-- > 0; )
+        {
+            nodes[i].b = recompute(uint32_t(i));
+        }
+    }
+
+    void updateAll(const vector<AABB>& items)
+    {
+        for(size_t k = 0; k<prims.size(); k++)
+        {
+            prims[k] = items[ids[k]].box();
+        }
+        refit();
+    }
+
+private:
+    //深度优先遍历时栈里最多有 树深+1 个节点; 一般的树用栈上的数组, 特别深时才分配
+    struct traversalStack
+    {
+        uint32_t local[64];
+        vector<uint32_t> heap;
+        uint32_t* data;
+
+        explicit traversalStack(uint32_t depth) : data(local)
+        {
+            if(depth + 1 > 64)
+            {
+                heap.resize(depth + 1);
+                data = heap.data();
+            }
+        }
+    };
+
+    struct primRef
+    {
+        bounds b;
+        float c[3];
+        uint32_t id;
+    };
+
+    struct buildNode
+    {
+        bounds b;
+        unique_ptr<buildNode> left;
+        unique_ptr<buildNode> right;
+        uint32_t first;
+        uint32_t count;
+        int axis;
+    };
+
+    static unique_ptr<buildNode> makeLeaf(const bounds& b, uint32_t first, uint32_t count)
+    {
+        unique_ptr<buildNode> leaf(new buildNode());
+        leaf->b = b;
+        leaf->first = first;
+        leaf->count = count;
+        leaf->axis = 0;
+        return leaf;
+    }
+
+    static unique_ptr<buildNode> buildRange(vector<primRef>& refs, uint32_t first, uint32_t last, int parallelDepth)
+    {
+        uint32_t count = last - first;
+        bounds b = bounds::empty();
+        bounds cb = bounds::empty();
+        for(uint32_t i = first; i<last; i++)
+        {
+            b.grow(refs[i].b);
+            cb.grow(refs[i].c);
+        }
+        if(count <= 2)
+        {
+            return makeLeaf(b, first, count);
+        }
+
+        //在每个轴上把中心分桶, 计算在每个桶边界切开的代价: 左边表面积*左边个数 + 右边表面积*右边个数
+        float bestCost = FLT_MAX;
+        int bestAxis = -1;
+        int bestSplit = 0;
+        for(int axis = 0; axis<3; axis++)
+        {
+            float extent = cb.hi[axis] - cb.lo[axis];
+            if(extent <= 0)
+            {
+                continue;
+            }
+            bounds binBounds[BINS];
+            uint32_t binCount[BINS] = {};
+            for(int k = 0; k<BINS; k++)
+            {
+                binBounds[k] = bounds::empty();
+            }
+            float scale = BINS / extent;
+            for(uint32_t i = first; i<last; i++)
+            {
+                int k = min(BINS - 1, int((refs[i].c[axis] - cb.lo[axis]) * scale));
+                binBounds[k].grow(refs[i].b);
+                binCount[k]++;
+            }
+            float rightArea[BINS];
+            uint32_t rightCount[BINS];
+            bounds acc = bounds::empty();
+            uint32_t n = 0;
+            for(int k = BINS - 1; k>0; k--)
+            {
+                acc.grow(binBounds[k]);
+                n += binCount[k];
+                rightArea[k] = acc.surfaceArea();
+                rightCount[k] = n;
+            }
+            acc = bounds::empty();
+            n = 0;
+            for(int k = 1; k<BINS; k++)
+            {
+                acc.grow(binBounds[k - 1]);
+                n += binCount[k - 1];
+                if(n == 0 || rightCount[k] == 0)
+                {
+                    continue;
+                }
+                float cost = acc.surfaceArea() * n + rightArea[k] * rightCount[k];
+                if(cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = k;
+                }
+            }
+        }
+
+        //不切的代价: 每个图元都要测一次. 切开的代价再加上测两个孩子包围盒的开销
+        float leafCost = b.surfaceArea() * count;
+        uint32_t mid;
+        if(bestAxis < 0)
+        {
+            //所有中心重合, 没法按位置分, 太多时按个数对半分
+            if(count <= MAX_LEAF)
+            {
+                return makeLeaf(b, first, count);
+            }
+            bestAxis = 0;
+            mid = first + count / 2;
+        }
+        else
+        {
+            if(count <= MAX_LEAF && bestCost + b.surfaceArea() >= leafCost)
+            {
+                return makeLeaf(b, first, count);
+            }
+            float lo = cb.lo[bestAxis];
+            float scale = BINS / (cb.hi[bestAxis] - lo);
+            int axis = bestAxis;
+            int split = bestSplit;
+            primRef* p = partition(&refs[first], &refs[0] + last, [axis, split, lo, scale](const primRef& r)
+            {
+                return min(BINS - 1, int((r.c[axis] - lo) * scale)) < split;
+            });
+            mid = uint32_t(p - &refs[0]);
+        }
+
+        unique_ptr<buildNode> nd(new buildNode());
+        nd->b = b;
+        nd->first = first;
+        nd->count = 0;
+        nd->axis = bestAxis;
+        if(parallelDepth > 0 && count >= PARALLEL_MIN)
+        {
+            //两个孩子用的是refs里不相交的两段, 可以同时建
+            future<unique_ptr<buildNode>> left = async(launch::async, buildRange, ref(refs), first, mid, parallelDepth - 1);
+            nd->right = buildRange(refs, mid, last, parallelDepth - 1);
+            nd->left = left.get();
+        }
+        else
+        {
+            nd->left = buildRange(refs, first, mid, 0);
+            nd->right = buildRange(refs, mid, last, 0);
+        }
+        return nd;
+    }
+
+    uint32_t flatten(const buildNode* bn, uint32_t parent, uint32_t depth)
+    {
+        maxDepth = max(maxDepth, depth);
+        uint32_t i = uint32_t(nodes.size());
+        nodes.push_back(node());
+        parents.push_back(parent);
+        nodes[i].b = bn->b;
+        nodes[i].axis = uint16_t(bn->axis);
+        if(bn->left == NULL)
+        {
+            nodes[i].index = bn->first;
+            nodes[i].count = uint16_t(bn->count);
+        }
+        else
+        {
+            nodes[i].count = 0;
+            flatten(bn->left.get(), i, depth + 1);
+            uint32_t right = flatten(bn->right.get(), i, depth + 1);
+            nodes[i].index = right;
+        }
+        return i;
+    }
+
+    bounds recompute(uint32_t i) const
+    {
+        const node& nd = nodes[i];
+        bounds b = bounds::empty();
+        if(nd.count > 0)
+        {
+            for(uint32_t k = nd.index; k<nd.index + nd.count; k++)
+            {
+                b.grow(prims[k]);
+            }
+        }
+        else
+        {
+            b = nodes[i + 1].b;
+            b.grow(nodes[nd.index].b);
+        }
+        return b;
+    }
+
+    vector<node> nodes;
+    vector<uint32_t> parents;
+    vector<bounds> prims;       //按叶子顺序排列的图元包围盒
+    vector<uint32_t> ids;       //prims[k]是第几个盒子
+    vector<uint32_t> slotOf;    //第id个盒子在prims里的位置
+    vector<uint32_t> leafOf;    //第id个盒子在哪个叶子里
+    uint32_t maxDepth = 0;
+};
+
+static vector<AABB> randomBoxes(size_t n, mt19937& rng)
+{
+    uniform_real_distribution<float> pos(0, 1000);
+    uniform_real_distribution<float> size(0.5f, 4);
+    vector<AABB> items;
+    items.reserve(n);
+    for(size_t i = 0; i<n; i++)
+    {
+        items.push_back(AABB(pos(rng), pos(rng), pos(rng), size(rng), size(rng), size(rng)));
+    }
+    return items;
+}
+
+static void bruteOverlap(const vector<AABB>& items, const bounds& q, vector<uint32_t>& out)
+{
+    out.clear();
+    for(size_t i = 0; i<items.size(); i++)
+    {
+        if(items[i].box().overlaps(q))
+        {
+            out.push_back(uint32_t(i));
+        }
+    }
+}
+
+static int bruteRay(const vector<AABB>& items, const ray& r, float& tHit)
+{
+    float inv[3] = {1.0f / r.dir[0], 1.0f / r.dir[1], 1.0f / r.dir[2]};
+    int best = -1;
+    tHit = FLT_MAX;
+    for(size_t i = 0; i<items.size(); i++)
+    {
+        float t = rayEnter(items[i].box(), r.origin, inv, tHit);
+        if(t < tHit)
+        {
+            tHit = t;
+            best = int(i);
+        }
+    }
+    return best;
+}
+
+void test01()
+{
+    vector<AABB> items;
+    items.push_back(AABB(0, 0, 0, 2, 2, 2));
+    items.push_back(AABB(5, 0, 0, 2, 2, 2));
+    items.push_back(AABB(10, 0, 0, 2, 2, 2));
+    items.push_back(AABB(5, 5, 0, 4, 4, 4));
+    bvh tree;
+    tree.build(items);
+
+    vector<uint32_t> hits;
+    float p[3] = {5, 1, 0};
+    tree.containing(p, hits);
+    cout<<"boxes containing (5,1,0):";
+    for(size_t i = 0; i<hits.size(); i++)
+    {
+        cout<<" "<<hits[i];
+    }
+    cout<<endl;
+
+    ray r = {{-10, 0, 0}, {1, 0, 0}};
+    float t;
+    cout<<"ray along +x hits box "<<tree.raycast(r, t)<<" at t="<<t<<endl;
+
+    //第0个盒子挪到射线后面去
+    items[0].setPosition(20, 0, 0);
+    tree.move(0, items[0]);
+    cout<<"after moving box 0: ray hits box "<<tree.raycast(r, t)<<" at t="<<t<<endl;
+}
+
+void test02()
+{
+    mt19937 rng(42);
+    const size_t n = 300000;
+    vector<AABB> items = randomBoxes(n, rng);
+
+    bvh serial;
+    bvh tree;
+    auto t0 = chrono::steady_clock::now();
+    serial.build(items, false);
+    auto t1 = chrono::steady_clock::now();
+    tree.build(items, true);
+    auto t2 = chrono::steady_clock::now();
+    cout<<n<<" boxes: build "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms serial, "
+        <<chrono::duration<double, milli>(t2 - t1).count()<<" ms parallel ("<<thread::hardware_concurrency()
+        <<" hardware threads), "<<tree.nodeCount()<<" nodes"<<endl;
+
+    //查询结果和逐个比较的结果对比
+    uniform_real_distribution<float> pos(0, 1000);
+    uniform_real_distribution<float> unit(-1, 1);
+    const int queries = 200;
+    vector<bounds> qs;
+    vector<ray> rays;
+    for(int i = 0; i<queries; i++)
+    {
+        AABB q(pos(rng), pos(rng), pos(rng), 20, 20, 20);
+        qs.push_back(q.box());
+        ray r = {{pos(rng), pos(rng), pos(rng)}, {unit(rng), unit(rng), unit(rng)}};
+        rays.push_back(r);
+    }
+
+    bool same = true;
+    vector<uint32_t> a, b;
+    auto t3 = chrono::steady_clock::now();
+    size_t found = 0;
+    for(int i = 0; i<queries; i++)
+    {
+        tree.overlapping(qs[i], a);
+        found += a.size();
+    }
+    auto t4 = chrono::steady_clock::now();
+    for(int i = 0; i<queries; i++)
+    {
+        bruteOverlap(items, qs[i], b);
+        tree.overlapping(qs[i], a);
+        sort(a.begin(), a.end());
+        same = same && a == b;
+    }
+    auto t5 = chrono::steady_clock::now();
+    for(int i = 0; i<queries; i++)
+    {
+        float ta, tb;
+        int ha = tree.raycast(rays[i], ta);
+        int hb = bruteRay(items, rays[i], tb);
+        same = same && ha == hb;
+    }
+    cout<<queries<<" overlap queries ("<<found<<" hits): bvh "<<chrono::duration<double, milli>(t4 - t3).count()
+        <<" ms, brute force "<<chrono::duration<double, milli>(t5 - t4).count()<<" ms; rays checked too: "
+        <<(same ? "same" : "DIFFERENT")<<endl;
+
+    //所有盒子都挪一点, 整体refit, 再和重建以后的结果对比
+    uniform_real_distribution<float> jitter(-2, 2);
+    for(size_t i = 0; i<n; i++)
+    {
+        items[i].setPosition(items[i].center[0] + jitter(rng), items[i].center[1] + jitter(rng), items[i].center[2] + jitter(rng));
+    }
+    auto t6 = chrono::steady_clock::now();
+    tree.updateAll(items);
+    auto t7 = chrono::steady_clock::now();
+    for(int i = 0; i<queries; i++)
+    {
+        bruteOverlap(items, qs[i], b);
+        tree.overlapping(qs[i], a);
+        sort(a.begin(), a.end());
+        same = same && a == b;
+    }
+    //单个盒子挪很远, 走move
+    for(int i = 0; i<100; i++)
+    {
+        uint32_t id = uint32_t(rng() % n);
+        items[id].setPosition(pos(rng), pos(rng), pos(rng));
+        tree.move(id, items[id]);
+    }
+    for(int i = 0; i<queries; i++)
+    {
+        bruteOverlap(items, qs[i], b);
+        tree.overlapping(qs[i], a);
+        sort(a.begin(), a.end());
+        same = same && a == b;
+    }
+    cout<<"refit after moving all boxes: "<<chrono::duration<double, milli>(t7 - t6).count()<<" ms ("
+        <<(same ? "same" : "DIFFERENT")<<")"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+
+    system("pause");
+}
@@ -0,0 +1,305 @@
+#include<iostream>
+#include<vector>
+#include<string>
+#include<tuple>
+#include<utility>
+#include<chrono>
+#include<stdexcept>
+#include<type_traits>
+#include<cstddef>
+using namespace std;
+
+//按列存储的容器(structure of arrays)
+//每个字段一个连续的vector, 只扫描年龄的时候不会把名字也读进缓存
+//push_back/emplace_back中途某一列抛异常时, 已经加上的列会撤回, 各列长度始终一样
+
+//一列数据的视图, 就是一段连续内存
+template<class T>
+class columnSpan
+{
+public:
+    columnSpan(T* p, size_t n) : ptr(p), len(n) {}
+
+    T* data() const { return ptr; }
+    size_t size() const { return len; }
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + len; }
+    T& operator[](size_t i) const { return ptr[i]; }
+
+private:
+    T* ptr;
+    size_t len;
+};
+
+template<class... Fields>
+class soa_vector
+{
+    //vector<bool>按位压缩, 没有data(), 也拿不到元素的引用; 标志位请用uint8_t或char
+    static_assert(!disjunction<is_same<Fields, bool>...>::value, "soa_vector cannot hold bool fields, use uint8_t instead");
+
+public:
+    //一行的代理对象, get<I>()拿到第I列里的那个元素
+    template<class Owner>
+    class rowRef
+    {
+    public:
+        rowRef(Owner* o, size_t i) : owner(o), index(i) {}
+
+        template<size_t I>
+        auto& get() const
+        {
+            return std::get<I>(owner->columns)[index];
+        }
+
+        tuple<Fields...> value() const
+        {
+            return valueImpl(index_sequence_for<Fields...>());
+        }
+
+    private:
+        template<size_t... I>
+        tuple<Fields...> valueImpl(index_sequence<I...>) const
+        {
+            return tuple<Fields...>(std::get<I>(owner->columns)[index]...);
+        }
+
+        Owner* owner;
+        size_t index;
+    };
+
+    typedef rowRef<soa_vector> reference;
+    typedef rowRef<const soa_vector> const_reference;
+
+    template<class Owner>
+    class rowIterator
+    {
+    public:
+        rowIterator(Owner* o, size_t i) : owner(o), index(i) {}
+
+        rowRef<Owner> operator*() const { return rowRef<Owner>(owner, index); }
+        rowIterator& operator++() { index++; return *this; }
+        rowIterator operator++(int) { rowIterator t = *this; index++; return t; }
+        bool operator==(const rowIterator& r) const { return index == r.index; }
+        bool operator!=(const rowIterator& r) const { return index != r.index; }
+
+    private:
+        Owner* owner;
+        size_t index;
+    };
+
+    typedef rowIterator<soa_vector> iterator;
+    typedef rowIterator<const soa_vector> const_iterator;
+
+    size_t size() const
+    {
+        return std::get<0>(columns).size();
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    void reserve(size_t n)
+    {
+        apply([n](auto&... col) { (col.reserve(n), ...); }, columns);
+    }
+
+    void clear()
+    {
+        apply([](auto&... col) { (col.clear(), ...); }, columns);
+    }
+
+    void push_back(const Fields&... values)
+    {
+        pushImpl(index_sequence_for<Fields...>(), values...);
+    }
+
+    template<class... Args>
+    void emplace_back(Args&&... args)
+    {
+        static_assert(sizeof...(Args) == sizeof...(Fields), "emplace_back needs one argument per field");
+        emplaceImpl(index_sequence_for<Fields...>(), std::forward<Args>(args)...);
+    }
+
+    void pop_back()
+    {
+        apply([](auto&... col) { (col.pop_back(), ...); }, columns);
+    }
+
+    reference operator[](size_t i) { return reference(this, i); }
+    const_reference operator[](size_t i) const { return const_reference(this, i); }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    //第I列的连续内存, 适合写成能被编译器向量化的循环
+    template<size_t I>
+    auto column()
+    {
+        auto& col = std::get<I>(columns);
+        return columnSpan<typename remove_reference<decltype(col[0])>::type>(col.data(), col.size());
+    }
+
+    template<size_t I>
+    auto column() const
+    {
+        const auto& col = std::get<I>(columns);
+        return columnSpan<const typename tuple_element<I, tuple<Fields...>>::type>(col.data(), col.size());
+    }
+
+private:
+    //done记下已经加好的列数, 出异常时把这些列各去掉最后一个
+    template<size_t... I>
+    void pushImpl(index_sequence<I...> seq, const Fields&... values)
+    {
+        size_t done = 0;
+        try
+        {
+            ((std::get<I>(columns).push_back(values), done++), ...);
+        }
+        catch(...)
+        {
+            rollback(seq, done);
+            throw;
+        }
+    }
+
+    template<size_t... I, class... Args>
+    void emplaceImpl(index_sequence<I...> seq, Args&&... args)
+    {
+        size_t done = 0;
+        try
+        {
+            ((std::get<I>(columns).emplace_back(std::forward<Args>(args)), done++), ...);
+        }
+        catch(...)
+        {
+            rollback(seq, done);
+            throw;
+        }
+    }
+
+    template<size_t... I>
+    void rollback(index_sequence<I...>, size_t done)
+    {
+        ((I < done ? std::get<I>(columns).pop_back() : void()), ...);
+    }
+
+    tuple<vector<Fields>...> columns;
+};
+
+class preson
+{
+public:
+    preson(string name, int age)
+    {
+        this->pr_name = name;
+        this->pr_age = age;
+    }
+
+    string pr_name;
+    int pr_age;
+};
+
+enum { NAME, AGE };
+
+//构造时检查年龄, 用来测试push到一半抛异常
+struct throwingAge
+{
+    throwingAge(int a) : age(a)
+    {
+        if(a < 0)
+        {
+            throw invalid_argument("negative age");
+        }
+    }
+
+    int age;
+};
+
+//年龄列是连续的int, 这个循环没有分支, 编译器可以直接向量化
+size_t countOlderThan(columnSpan<const int> ages, int limit)
+{
+    size_t count = 0;
+    const int* a = ages.data();
+    for(size_t i = 0; i<ages.size(); i++)
+    {
+        count += a[i] > limit;
+    }
+    return count;
+}
+
+void test01()
+{
+    soa_vector<string, int> v;
+
+    v.push_back("zhangsan", 10);
+    v.push_back("lisi"    , 10);
+    v.emplace_back("wangwun" , 30);
+    v.emplace_back("zhaoliu" , 60);
+    v.emplace_back(string("caoqi"), 90);
+
+    v[1].get<AGE>() = 20;
+
+    for(soa_vector<string, int>::iterator it = v.begin(); it != v.end(); it++)
+    {
+        cout<<"the name is:"<<(*it).get<NAME>()<<" the age is:"<<(*it).get<AGE>()<<endl;
+    }
+
+    const soa_vector<string, int>& cv = v;
+    cout<<"age > 30: "<<countOlderThan(cv.column<AGE>(), 30)<<endl;
+
+    //第二列构造失败, 第一列刚加上的名字要撤回
+    soa_vector<string, throwingAge> t;
+    t.emplace_back("zhangsan", 10);
+    try
+    {
+        t.emplace_back("lisi", -1);
+    }
+    catch(const invalid_argument& e)
+    {
+        cout<<"error: "<<e.what()<<", names "<<t.column<NAME>().size()<<", ages "<<t.column<AGE>().size()<<endl;
+    }
+}
+
+void test02()
+{
+    const int n = 10000000;
+    const char* names[] = {"zhangsan", "lisi", "wangwun", "zhaoliu", "caoqi"};
+
+    vector<preson> aos;
+    soa_vector<string, int> soa;
+    aos.reserve(n);
+    soa.reserve(n);
+    for(int i = 0; i<n; i++)
+    {
+        int age = (i * 37) % 100;
+        aos.push_back(preson(names[i % 5], age));
+        soa.push_back(names[i % 5], age);
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    size_t c1 = 0;
+    for(vector<preson>::iterator it = aos.begin(); it != aos.end(); it++)
+    {
+        c1 += it->pr_age > 30;
+    }
+    auto t1 = chrono::steady_clock::now();
+    const soa_vector<string, int>& csoa = soa;
+    size_t c2 = countOlderThan(csoa.column<AGE>(), 30);
+    auto t2 = chrono::steady_clock::now();
+
+    cout<<"vector<preson>: "<<c1<<" in "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms"<<endl;
+    cout<<"soa_vector    : "<<c2<<" in "<<chrono::duration<double, milli>(t2 - t1).count()<<" ms"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+
+    system("pause");
+}
@@ -0,0 +1,325 @@
+#include<iostream>
+#include<vector>
+#include<chrono>
+#include<cstddef>
+#include<initializer_list>
+#include<stdexcept>
+#include<functional>
+#include<type_traits>
+using namespace std;
+
+//扁平的二维容器
+//matrix2d: 每行宽度固定, 所有元素按行连续存放在一个vector里
+//jagged2d: 每行宽度不同, CSR方式存放, values放所有元素, offsets记录每行的起点
+
+//一行的视图, 不拥有数据
+template<class T>
+class rowView
+{
+public:
+    rowView(T* p, size_t n) : ptr(p), len(n) {}
+
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + len; }
+    size_t size() const { return len; }
+    T& operator[](size_t i) const { return ptr[i]; }
+
+private:
+    T* ptr;
+    size_t len;
+};
+
+//行视图的迭代器就是指针, 可能指向容器自己的values(m.push_back(r.begin(), r.end()), r = m.row(i))
+//这时values.insert扩容会让源数据失效, 要先拷出来
+template<class T, class It>
+bool pointsInto(const vector<T>& values, It first)
+{
+    if constexpr(is_pointer<It>::value)
+    {
+        const T* p = first;
+        return less_equal<const T*>()(values.data(), p) && less<const T*>()(p, values.data() + values.size());
+    }
+    else
+    {
+        return false;
+    }
+}
+
+//一列的迭代器, 每次跨过一整行
+template<class T>
+class strideIterator
+{
+public:
+    strideIterator(T* p, size_t s) : ptr(p), stride(s) {}
+
+    T& operator*() const { return *ptr; }
+    strideIterator& operator++() { ptr += stride; return *this; }
+    bool operator!=(const strideIterator& r) const { return ptr != r.ptr; }
+
+private:
+    T* ptr;
+    size_t stride;
+};
+
+template<class T>
+class columnView
+{
+public:
+    columnView(T* p, size_t rows, size_t stride) : ptr(p), n(rows), step(stride) {}
+
+    strideIterator<T> begin() const { return strideIterator<T>(ptr, step); }
+    strideIterator<T> end() const { return strideIterator<T>(ptr + n * step, step); }
+    size_t size() const { return n; }
+    T& operator[](size_t i) const { return ptr[i * step]; }
+
+private:
+    T* ptr;
+    size_t n;
+    size_t step;
+};
+
+template<class T>
+class matrix2d
+{
+public:
+    explicit matrix2d(size_t cols) : width(cols), height(0) {}
+    matrix2d(size_t rows, size_t cols, const T& value = T())
+        : values(rows * cols, value), width(cols), height(rows) {}
+
+    size_t rows() const { return height; }
+    size_t cols() const { return width; }
+
+    void reserve(size_t rows)
+    {
+        values.reserve(rows * width);
+    }
+
+    //追加一行, 长度必须等于cols()
+    template<class It>
+    void push_back(It first, It last)
+    {
+        if(pointsInto(values, first))
+        {
+            vector<T> row(first, last);
+            push_back(row.begin(), row.end());
+            return;
+        }
+        size_t before = values.size();
+        values.insert(values.end(), first, last);
+        if(values.size() - before != width)
+        {
+            values.resize(before);
+            throw length_error("matrix2d::push_back: row width mismatch");
+        }
+        height++;
+    }
+
+    void push_back(initializer_list<T> row)
+    {
+        push_back(row.begin(), row.end());
+    }
+
+    T& operator()(size_t r, size_t c) { return values[r * width + c]; }
+    const T& operator()(size_t r, size_t c) const { return values[r * width + c]; }
+
+    rowView<T> row(size_t r) { return rowView<T>(values.data() + r * width, width); }
+    rowView<const T> row(size_t r) const { return rowView<const T>(values.data() + r * width, width); }
+
+    columnView<T> column(size_t c) { return columnView<T>(values.data() + c, height, width); }
+    columnView<const T> column(size_t c) const { return columnView<const T>(values.data() + c, height, width); }
+
+    T* data() { return values.data(); }
+    const T* data() const { return values.data(); }
+
+private:
+    vector<T> values;
+    size_t width;
+    size_t height;
+};
+
+template<class T>
+class jagged2d
+{
+public:
+    jagged2d() : offsets(1, 0) {}
+
+    size_t rows() const { return offsets.size() - 1; }
+    size_t totalSize() const { return values.size(); }
+
+    void reserve(size_t rows, size_t total)
+    {
+        offsets.reserve(rows + 1);
+        values.reserve(total);
+    }
+
+    template<class It>
+    void push_back(It first, It last)
+    {
+        if(pointsInto(values, first))
+        {
+            vector<T> row(first, last);
+            push_back(row.begin(), row.end());
+            return;
+        }
+        values.insert(values.end(), first, last);
+        offsets.push_back(values.size());
+    }
+
+    void push_back(initializer_list<T> row)
+    {
+        push_back(row.begin(), row.end());
+    }
+
+    rowView<T> row(size_t r) { return rowView<T>(values.data() + offsets[r], offsets[r + 1] - offsets[r]); }
+    rowView<const T> row(size_t r) const { return rowView<const T>(values.data() + offsets[r], offsets[r + 1] - offsets[r]); }
+    rowView<T> operator[](size_t r) { return row(r); }
+    rowView<const T> operator[](size_t r) const { return row(r); }
+
+    //所有元素连续存放, 不关心行边界时可以直接整体遍历
+    rowView<T> all() { return rowView<T>(values.data(), values.size()); }
+
+private:
+    vector<T> values;
+    vector<size_t> offsets;
+};
+
+void test01()
+{
+    matrix2d<int> m(5);
+    m.reserve(5);
+
+    //直接写进大容器, 不需要先建小容器再拷贝
+    for(int r = 0; r<5; r++)
+    {
+        m.push_back({r+1, r+2, r+3, r+4, r+5});
+    }
+
+    for(size_t r = 0; r<m.rows(); r++)
+    {
+        for(int x : m.row(r))
+        {
+            cout<<x<<" ";
+        }
+        cout<<endl;
+    }
+
+    cout<<"column 2:";
+    for(int x : m.column(2))
+    {
+        cout<<" "<<x;
+    }
+    cout<<endl;
+
+    jagged2d<int> j;
+    j.reserve(4, 10);
+    j.push_back({1});
+    j.push_back({2, 3});
+    j.push_back({});
+    j.push_back({4, 5, 6, 7});
+
+    //把已有的行再加一遍, 源数据在自己里面
+    m.push_back(m.row(1).begin(), m.row(1).end());
+    j.push_back(j[3].begin(), j[3].end());
+    cout<<"row 5:";
+    for(int x : m.row(5))
+    {
+        cout<<" "<<x;
+    }
+    cout<<endl;
+    for(size_t r = 0; r<j.rows(); r++)
+    {
+        cout<<"row "<<r<<":";
+        for(int x : j[r])
+        {
+            cout<<" "<<x;
+        }
+        cout<<endl;
+    }
+}
+
+void test02()
+{
+    const size_t rows = 4000;
+    const size_t cols = 4000;
+
+    auto t0 = chrono::steady_clock::now();
+    vector<vector<int>> v;
+    for(size_t r = 0; r<rows; r++)
+    {
+        vector<int> row;
+        for(size_t c = 0; c<cols; c++)
+        {
+            row.push_back(int(r + c));
+        }
+        v.push_back(row);
+    }
+    auto t1 = chrono::steady_clock::now();
+    matrix2d<int> m(cols);
+    m.reserve(rows);
+    vector<int> row(cols);
+    for(size_t r = 0; r<rows; r++)
+    {
+        for(size_t c = 0; c<cols; c++)
+        {
+            row[c] = int(r + c);
+        }
+        m.push_back(row.begin(), row.end());
+    }
+    auto t2 = chrono::steady_clock::now();
+
+    //按行遍历: 嵌套容器每行都要先取一次行指针, 扁平容器就是一整块连续内存
+    long long s1 = 0;
+    for(vector<vector<int>>::iterator it = v.begin(); it != v.end(); it++)
+    {
+        for(vector<int>::iterator vit = (*it).begin(); vit != (*it).end(); vit++)
+        {
+            s1 += *vit;
+        }
+    }
+    auto t3 = chrono::steady_clock::now();
+    long long s2 = 0;
+    for(size_t r = 0; r<m.rows(); r++)
+    {
+        for(int x : m.row(r))
+        {
+            s2 += x;
+        }
+    }
+    auto t4 = chrono::steady_clock::now();
+
+    //求每一列的和: 按列跳着读会不停地换缓存行, 按行读再累加到每列的结果里
+    vector<long long> colSum1(cols, 0);
+    for(size_t c = 0; c<cols; c++)
+    {
+        for(size_t r = 0; r<rows; r++)
+        {
+            colSum1[c] += v[r][c];
+        }
+    }
+    auto t5 = chrono::steady_clock::now();
+    vector<long long> colSum2(cols, 0);
+    for(size_t r = 0; r<m.rows(); r++)
+    {
+        rowView<int> cr = m.row(r);
+        for(size_t c = 0; c<cols; c++)
+        {
+            colSum2[c] += cr[c];
+        }
+    }
+    auto t6 = chrono::steady_clock::now();
+
+    cout<<"build  vector<vector<int>> "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms, matrix2d "
+        <<chrono::duration<double, milli>(t2 - t1).count()<<" ms"<<endl;
+    cout<<"rows   vector<vector<int>> "<<chrono::duration<double, milli>(t3 - t2).count()<<" ms, matrix2d "
+        <<chrono::duration<double, milli>(t4 - t3).count()<<" ms ("<<(s1 == s2 ? "same" : "DIFFERENT")<<")"<<endl;
+    cout<<"colsum vector<vector<int>> "<<chrono::duration<double, milli>(t5 - t4).count()<<" ms, matrix2d "
+        <<chrono::duration<double, milli>(t6 - t5).count()<<" ms ("<<(colSum1 == colSum2 ? "same" : "DIFFERENT")<<")"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+
+    system("pause");
+}
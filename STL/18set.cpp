@@ -0,0 +1,673 @@
+#include<iostream>
+#include<vector>
+#include<set>
+#include<string>
+#include<algorithm>
+#include<functional>
+#include<random>
+#include<chrono>
+#include<utility>
+#include<new>
+#include<iterator>
+#include<cstddef>
+using namespace std;
+
+//B+树实现的有序集合
+//一个节点里连续存放很多个key, 查找时每层只需要访问一个节点, 遍历时沿着叶子链表顺序读
+//key直接放在节点内部的定长数组里(不是vector), 叶子和内部节点各是一整块内存, 中间没有额外的指针跳转
+//还没用到的槽位不构造, K不需要默认构造函数
+//Multi为true时是multiset, 相等的key都保留, 按插入先后排列
+//比较器和set一样传仿函数, 仿函数的operator()不是const也可以用
+
+template<class K, class Compare = less<K>, bool Multi = false, int NodeCap = 64>
+class btree
+{
+    //分裂后两边至少各有一个key, 批量建树时每个节点至少两个孩子
+    static_assert(NodeCap >= 3, "NodeCap must be at least 3");
+
+    //节点里最多暂时放NodeCap个key, 达到NodeCap立刻分裂, 所以平时最多NodeCap-1个
+    struct node
+    {
+        bool leaf;
+        size_t n;
+        alignas(K) unsigned char raw[sizeof(K) * NodeCap];
+
+        explicit node(bool isLeaf) : leaf(isLeaf), n(0) {}
+
+        K* keys() { return reinterpret_cast<K*>(raw); }
+        const K* keys() const { return reinterpret_cast<const K*>(raw); }
+    };
+
+    struct leafNode : node
+    {
+        leafNode* next;         //叶子节点之间的链表
+        leafNode* prev;
+
+        leafNode() : node(true), next(NULL), prev(NULL) {}
+    };
+
+    struct innerNode : node
+    {
+        node* children[NodeCap + 1];    //前n+1个有效
+
+        innerNode() : node(false) {}
+    };
+
+public:
+    class iterator
+    {
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef K value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const K* pointer;
+        typedef const K& reference;
+
+        iterator() : nd(NULL), idx(0) {}
+        iterator(leafNode* n, size_t i) : nd(n), idx(i)
+        {
+            skipEmpty();
+        }
+
+        const K& operator*() const { return nd->keys()[idx]; }
+        const K* operator->() const { return &nd->keys()[idx]; }
+
+        iterator& operator++()
+        {
+            idx++;
+            skipEmpty();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator t = *this;
+            ++*this;
+            return t;
+        }
+
+        bool operator==(const iterator& r) const { return nd == r.nd && idx == r.idx; }
+        bool operator!=(const iterator& r) const { return !(*this == r); }
+
+    private:
+        //删除后可能留下空叶子, 直接跳过
+        void skipEmpty()
+        {
+            while(nd != NULL && idx >= nd->n)
+            {
+                nd = nd->next;
+                idx = 0;
+            }
+        }
+
+        leafNode* nd;
+        size_t idx;
+        friend class btree;
+    };
+
+    typedef iterator const_iterator;
+
+    //空树不分配节点, root为NULL; 第一次插入时才建根
+    explicit btree(const Compare& c = Compare()) : root(NULL), head(NULL), count(0), comp(c) {}
+
+    ~btree()
+    {
+        destroy(root);
+    }
+
+    btree(const btree&) = delete;
+    btree& operator=(const btree&) = delete;
+
+    btree(btree&& r) noexcept : root(r.root), head(r.head), count(r.count), comp(r.comp)
+    {
+        r.root = NULL;
+        r.head = NULL;
+        r.count = 0;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    iterator begin() const { return iterator(head, 0); }
+    iterator end() const { return iterator(); }
+
+    void clear()
+    {
+        destroy(root);
+        root = NULL;
+        head = NULL;
+        count = 0;
+    }
+
+    //返回插入的位置和是否插入成功, set里已有相等的key时不插入
+    pair<iterator, bool> insert(const K& key)
+    {
+        if(!Multi)
+        {
+            iterator it = lower_bound(key);
+            if(it != end() && !comp(key, *it))
+            {
+                return make_pair(it, false);
+            }
+        }
+        if(root == NULL)
+        {
+            leafNode* l = new leafNode();
+            root = l;
+            head = l;
+        }
+
+        node* splitNode = NULL;
+        K splitKey = key;
+        insertRec(root, key, splitNode, splitKey);
+        if(splitNode != NULL)
+        {
+            innerNode* newRoot = new innerNode();
+            insertKey(newRoot, 0, splitKey);
+            newRoot->children[0] = root;
+            newRoot->children[1] = splitNode;
+            root = newRoot;
+        }
+        count++;
+        return make_pair(Multi ? upperPrev(key) : lower_bound(key), true);
+    }
+
+    //第一个不小于key的位置
+    iterator lower_bound(const K& key) const
+    {
+        if(root == NULL)
+        {
+            return end();
+        }
+        node* n = root;
+        while(!n->leaf)
+        {
+            size_t i = std::lower_bound(n->keys(), n->keys() + n->n, key, compRef()) - n->keys();
+            n = static_cast<innerNode*>(n)->children[i];
+        }
+        size_t i = std::lower_bound(n->keys(), n->keys() + n->n, key, compRef()) - n->keys();
+        return iterator(static_cast<leafNode*>(n), i);
+    }
+
+    //第一个大于key的位置
+    iterator upper_bound(const K& key) const
+    {
+        if(root == NULL)
+        {
+            return end();
+        }
+        node* n = root;
+        while(!n->leaf)
+        {
+            size_t i = std::upper_bound(n->keys(), n->keys() + n->n, key, compRef()) - n->keys();
+            n = static_cast<innerNode*>(n)->children[i];
+        }
+        size_t i = std::upper_bound(n->keys(), n->keys() + n->n, key, compRef()) - n->keys();
+        return iterator(static_cast<leafNode*>(n), i);
+    }
+
+    pair<iterator, iterator> equal_range(const K& key) const
+    {
+        return make_pair(lower_bound(key), upper_bound(key));
+    }
+
+    iterator find(const K& key) const
+    {
+        iterator it = lower_bound(key);
+        if(it != end() && !comp(key, *it))
+        {
+            return it;
+        }
+        return end();
+    }
+
+    size_t count_of(const K& key) const
+    {
+        size_t n = 0;
+        for(iterator it = lower_bound(key); it != end() && !comp(key, *it); ++it)
+        {
+            n++;
+        }
+        return n;
+    }
+
+    //删除所有和key相等的元素, 返回删除的个数
+    //只从叶子里移除, 不合并节点, 分隔key仍然是有效的上下界
+    size_t erase(const K& key)
+    {
+        size_t removed = 0;
+        iterator it = lower_bound(key);
+        while(it != end() && !comp(key, *it))
+        {
+            leafNode* n = it.nd;
+            size_t last = it.idx;
+            while(last < n->n && !comp(key, n->keys()[last]))
+            {
+                last++;
+            }
+            eraseKeys(n, it.idx, last);
+            removed += last - it.idx;
+            it = iterator(n, it.idx);
+        }
+        count -= removed;
+        return removed;
+    }
+
+    //从已经排好序的数据批量建树, 叶子填满约3/4, 给后续插入留空间
+    template<class It>
+    void bulk_load(It first, It last)
+    {
+        clear();
+        const size_t fill = NodeCap * 3 / 4;
+
+        vector<node*> level;
+        vector<K> firstKeys;
+        leafNode* cur = NULL;
+        for(; first != last; ++first)
+        {
+            if(!Multi && cur != NULL && cur->n > 0 && !comp(cur->keys()[cur->n - 1], *first))
+            {
+                continue;
+            }
+            if(cur == NULL || cur->n == fill)
+            {
+                leafNode* n = new leafNode();
+                if(cur != NULL)
+                {
+                    cur->next = n;
+                    n->prev = cur;
+                }
+                else
+                {
+                    head = n;
+                    root = n;
+                }
+                cur = n;
+                level.push_back(cur);
+                firstKeys.push_back(*first);
+            }
+            insertKey(cur, cur->n, *first);
+            count++;
+        }
+
+        //一层一层往上建内部节点; 每个节点最多NodeCap个孩子(NodeCap-1个key), 之后插入还能放下
+        const size_t fanout = max<size_t>(2, min<size_t>(fill + 1, NodeCap - 1));
+        while(level.size() > 1)
+        {
+            vector<node*> upper;
+            vector<K> upperKeys;
+            for(size_t i = 0; i < level.size(); )
+            {
+                size_t take = min(fanout, level.size() - i);
+                //最后只剩一个孩子时并到前一个节点里
+                if(level.size() - i - take == 1)
+                {
+                    take++;
+                }
+                innerNode* n = new innerNode();
+                for(size_t j = 0; j<take; j++)
+                {
+                    n->children[j] = level[i + j];
+                    if(j > 0)
+                    {
+                        insertKey(n, n->n, firstKeys[i + j]);
+                    }
+                }
+                upper.push_back(n);
+                upperKeys.push_back(firstKeys[i]);
+                i += take;
+            }
+            level.swap(upper);
+            firstKeys.swap(upperKeys);
+            root = level[0];
+        }
+    }
+
+private:
+    struct compWrap
+    {
+        Compare* c;
+        bool operator()(const K& a, const K& b) const { return (*c)(a, b); }
+    };
+
+    compWrap compRef() const
+    {
+        compWrap w;
+        w.c = &comp;
+        return w;
+    }
+
+    //在第i个位置插入key, 后面的往右挪一格; 调用前n < NodeCap
+    static void insertKey(node* nd, size_t i, const K& key)
+    {
+        K* k = nd->keys();
+        if(i == nd->n)
+        {
+            new(k + i) K(key);
+        }
+        else
+        {
+            K tmp(key);
+            new(k + nd->n) K(std::move(k[nd->n - 1]));
+            move_backward(k + i, k + nd->n - 1, k + nd->n);
+            k[i] = std::move(tmp);
+        }
+        nd->n++;
+    }
+
+    //删掉[a, b), 后面的往前挪
+    static void eraseKeys(node* nd, size_t a, size_t b)
+    {
+        K* k = nd->keys();
+        K* newEnd = std::move(k + b, k + nd->n, k + a);
+        destroyKeys(newEnd, k + nd->n);
+        nd->n -= b - a;
+    }
+
+    static void destroyKeys(K* first, K* last)
+    {
+        for(; first != last; ++first)
+        {
+            first->~K();
+        }
+    }
+
+    //把from的第i个以后的key搬到空节点to里, from只留下前i个
+    static void moveKeys(node* from, size_t i, node* to)
+    {
+        K* src = from->keys();
+        K* dst = to->keys();
+        for(size_t j = i; j<from->n; j++)
+        {
+            new(dst + to->n) K(std::move(src[j]));
+            to->n++;
+        }
+        destroyKeys(src + i, src + from->n);
+        from->n = i;
+    }
+
+    //multiset里刚插入的元素是upper_bound的前一个
+    iterator upperPrev(const K& key) const
+    {
+        node* n = root;
+        while(!n->leaf)
+        {
+            size_t i = std::upper_bound(n->keys(), n->keys() + n->n, key, compRef()) - n->keys();
+            n = static_cast<innerNode*>(n)->children[i];
+        }
+        size_t i = std::upper_bound(n->keys(), n->keys() + n->n, key, compRef()) - n->keys();
+        return iterator(static_cast<leafNode*>(n), i - 1);
+    }
+
+    //插到upper_bound的位置, 节点满了就对半分裂, 通过splitNode/splitKey把新节点交给上一层
+    void insertRec(node* n, const K& key, node*& splitNode, K& splitKey)
+    {
+        size_t i = std::upper_bound(n->keys(), n->keys() + n->n, key, compRef()) - n->keys();
+        if(n->leaf)
+        {
+            insertKey(n, i, key);
+        }
+        else
+        {
+            innerNode* in = static_cast<innerNode*>(n);
+            node* childSplit = NULL;
+            K childKey = key;
+            insertRec(in->children[i], key, childSplit, childKey);
+            if(childSplit == NULL)
+            {
+                return;
+            }
+            insertKey(in, i, childKey);
+            for(size_t j = in->n; j > i + 1; j--)
+            {
+                in->children[j] = in->children[j - 1];
+            }
+            in->children[i + 1] = childSplit;
+        }
+
+        if(n->n < size_t(NodeCap))
+        {
+            return;
+        }
+
+        size_t mid = n->n / 2;
+        if(n->leaf)
+        {
+            leafNode* l = static_cast<leafNode*>(n);
+            leafNode* right = new leafNode();
+            moveKeys(l, mid, right);
+            splitKey = right->keys()[0];
+            right->next = l->next;
+            right->prev = l;
+            if(l->next != NULL)
+            {
+                l->next->prev = right;
+            }
+            l->next = right;
+            splitNode = right;
+        }
+        else
+        {
+            //中间的key上移, 左右各留一半
+            innerNode* in = static_cast<innerNode*>(n);
+            innerNode* right = new innerNode();
+            for(size_t j = mid + 1; j <= in->n; j++)
+            {
+                right->children[j - mid - 1] = in->children[j];
+            }
+            moveKeys(in, mid + 1, right);
+            splitKey = std::move(in->keys()[mid]);
+            eraseKeys(in, mid, mid + 1);
+            splitNode = right;
+        }
+    }
+
+    void destroy(node* n)
+    {
+        if(n == NULL)
+        {
+            return;
+        }
+        destroyKeys(n->keys(), n->keys() + n->n);
+        if(n->leaf)
+        {
+            delete static_cast<leafNode*>(n);
+            return;
+        }
+        innerNode* in = static_cast<innerNode*>(n);
+        for(size_t i = 0; i <= in->n; i++)
+        {
+            destroy(in->children[i]);
+        }
+        delete in;
+    }
+
+    node* root;
+    leafNode* head;
+    size_t count;
+    mutable Compare comp;
+};
+
+template<class K, class Compare = less<K>, int NodeCap = 64>
+using btree_set = btree<K, Compare, false, NodeCap>;
+
+template<class K, class Compare = less<K>, int NodeCap = 64>
+using btree_multiset = btree<K, Compare, true, NodeCap>;
+
+class preson
+{
+public:
+    preson(string name, int age)
+    {
+        this->pr_name = name;
+        this->pr_age = age;
+    }
+
+    string pr_name;
+    int pr_age;
+};
+
+class comparePreson
+{
+public:
+    bool operator()(const preson& pr1, const preson& pr2)
+    {
+        return pr1.pr_age>pr2.pr_age;
+    }
+};
+
+class myCompar
+{
+public:
+    bool operator()(int a, int b)
+    {
+       return a > b;
+    }
+};
+
+void test01()
+{
+    preson pr01("zhangfei", 20);
+    preson pr02("guanyu", 29);
+    preson pr03("liubei", 25);
+    preson pr04("zhaoyun", 30);
+    preson pr05("machao", 29);
+
+    //set按年龄去重, machao和guanyu同岁, 只会留下先插入的guanyu
+    btree_set<preson, comparePreson> s;
+    s.insert(pr01);
+    s.insert(pr02);
+    s.insert(pr03);
+    s.insert(pr04);
+    s.insert(pr05);
+    for(btree_set<preson, comparePreson>::iterator it = s.begin(); it != s.end(); it++)
+    {
+        cout<<"the name is:"<<it->pr_name<<" the age is:"<<it->pr_age<<endl;
+    }
+    cout<<"----"<<endl;
+
+    //multiset全部保留
+    btree_multiset<preson, comparePreson> ms;
+    ms.insert(pr01);
+    ms.insert(pr02);
+    ms.insert(pr03);
+    ms.insert(pr04);
+    ms.insert(pr05);
+    for(btree_multiset<preson, comparePreson>::iterator it = ms.begin(); it != ms.end(); it++)
+    {
+        cout<<"the name is:"<<it->pr_name<<" the age is:"<<it->pr_age<<endl;
+    }
+
+    //范围遍历: 年龄在[29, 25]之间(比较器是从大到小)
+    cout<<"age 29..25:";
+    btree_multiset<preson, comparePreson>::iterator last = ms.upper_bound(preson("", 25));
+    for(btree_multiset<preson, comparePreson>::iterator it = ms.lower_bound(preson("", 29)); it != last; ++it)
+    {
+        cout<<" "<<it->pr_name;
+    }
+    cout<<endl;
+}
+
+void test02()
+{
+    btree_set<int, myCompar, 8> s1;
+    for(int i = 0; i<100; i++)
+    {
+        s1.insert(10 + (i * 37) % 100);
+    }
+    s1.erase(50);
+    for(btree_set<int, myCompar, 8>::iterator it = s1.begin(); it != s1.end(); it++)
+    {
+        cout<<*it<<" ";
+    }
+    cout<<endl;
+
+    vector<int> sorted;
+    for(int i = 0; i<20; i++)
+    {
+        sorted.push_back(i / 2);
+    }
+    btree_multiset<int, less<int>, 4> ms;
+    ms.bulk_load(sorted.begin(), sorted.end());
+    ms.insert(5);
+    cout<<"size "<<ms.size()<<", count(5) "<<ms.count_of(5)<<":";
+    for(btree_multiset<int, less<int>, 4>::iterator it = ms.begin(); it != ms.end(); it++)
+    {
+        cout<<" "<<*it;
+    }
+    cout<<endl;
+}
+
+void test03()
+{
+    const int n = 2000000;
+    mt19937 rng(7);
+    vector<int> keys(n);
+    for(int i = 0; i<n; i++)
+    {
+        keys[i] = int(rng());
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    set<int> s;
+    for(int i = 0; i<n; i++)
+    {
+        s.insert(keys[i]);
+    }
+    auto t1 = chrono::steady_clock::now();
+    btree_set<int> b;
+    for(int i = 0; i<n; i++)
+    {
+        b.insert(keys[i]);
+    }
+    auto t2 = chrono::steady_clock::now();
+
+    size_t f1 = 0;
+    for(int i = 0; i<n; i++)
+    {
+        f1 += s.find(keys[n - 1 - i]) != s.end();
+    }
+    auto t3 = chrono::steady_clock::now();
+    size_t f2 = 0;
+    for(int i = 0; i<n; i++)
+    {
+        f2 += b.find(keys[n - 1 - i]) != b.end();
+    }
+    auto t4 = chrono::steady_clock::now();
+
+    long long sum1 = 0;
+    for(set<int>::iterator it = s.begin(); it != s.end(); it++)
+    {
+        sum1 += *it;
+    }
+    auto t5 = chrono::steady_clock::now();
+    long long sum2 = 0;
+    for(btree_set<int>::iterator it = b.begin(); it != b.end(); it++)
+    {
+        sum2 += *it;
+    }
+    auto t6 = chrono::steady_clock::now();
+
+    vector<int> sorted(s.begin(), s.end());
+    btree_set<int> bl;
+    bl.bulk_load(sorted.begin(), sorted.end());
+    auto t7 = chrono::steady_clock::now();
+
+    cout<<"insert  set "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms, btree "
+        <<chrono::duration<double, milli>(t2 - t1).count()<<" ms"<<endl;
+    cout<<"find    set "<<chrono::duration<double, milli>(t3 - t2).count()<<" ms, btree "
+        <<chrono::duration<double, milli>(t4 - t3).count()<<" ms ("<<f1<<" "<<f2<<")"<<endl;
+    cout<<"iterate set "<<chrono::duration<double, milli>(t5 - t4).count()<<" ms, btree "
+        <<chrono::duration<double, milli>(t6 - t5).count()<<" ms ("<<(sum1 == sum2 ? "same" : "DIFFERENT")<<")"<<endl;
+    cout<<"bulk_load "<<chrono::duration<double, milli>(t7 - t6).count()<<" ms (includes copying to vector), size "
+        <<bl.size()<<" "<<(equal(bl.begin(), bl.end(), s.begin()) ? "same" : "DIFFERENT")<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+    test03();
+
+    system("pause");
+}
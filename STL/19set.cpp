@@ -0,0 +1,751 @@
+#include<iostream>
+#include<vector>
+#include<set>
+#include<algorithm>
+#include<iterator>
+#include<utility>
+#include<random>
+#include<chrono>
+#include<cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include<immintrin.h>
+#define ROARING_X86 1
+#endif
+using namespace std;
+
+//压缩位图集合(Roaring)
+//32位整数按高16位分块, 每块最多65536个数, 根据块内的分布选择存储方式:
+//  array : 有序的uint16数组, 元素不超过4096个时用
+//  bitmap: 1024个uint64, 固定8KB, 元素多时用
+//  run   : (起点, 长度-1)的区间列表, 调用runOptimize后连续段多的块会转成这种
+//集合运算在bitmap上按64位整字进行, 运算和数1的个数在同一遍里做完
+//bitmap的内核有标量版本和AVX2版本(查表数1的个数), 和STL/23numeric一样第一次用时检查CPU选用哪个
+//只有不是bitmap的那一边才临时展开成bitmap, 已经是bitmap的直接用
+
+static const size_t ARRAY_MAX = 4096;
+static const size_t BITMAP_WORDS = 1024;
+
+enum containerType { ARRAY, BITMAP, RUN };
+
+struct container
+{
+    containerType type;
+    uint32_t card;
+    vector<uint16_t> array;
+    vector<uint64_t> bits;
+    vector<pair<uint16_t, uint16_t>> runs;
+
+    container() : type(ARRAY), card(0) {}
+
+    bool contains(uint16_t v) const
+    {
+        if(type == ARRAY)
+        {
+            return binary_search(array.begin(), array.end(), v);
+        }
+        if(type == BITMAP)
+        {
+            return (bits[v >> 6] >> (v & 63)) & 1;
+        }
+        //找最后一个起点<=v的区间
+        vector<pair<uint16_t, uint16_t>>::const_iterator it =
+            upper_bound(runs.begin(), runs.end(), make_pair(v, uint16_t(0xFFFF)));
+        if(it == runs.begin())
+        {
+            return false;
+        }
+        --it;
+        return uint32_t(v) <= uint32_t(it->first) + it->second;
+    }
+
+    //把array或run的内容写成位图, b要有BITMAP_WORDS个0
+    void fillBitmap(uint64_t* b) const
+    {
+        if(type == ARRAY)
+        {
+            for(size_t i = 0; i<array.size(); i++)
+            {
+                b[array[i] >> 6] |= uint64_t(1) << (array[i] & 63);
+            }
+        }
+        else
+        {
+            for(size_t i = 0; i<runs.size(); i++)
+            {
+                uint32_t last = uint32_t(runs[i].first) + runs[i].second;
+                for(uint32_t v = runs[i].first; v <= last; v++)
+                {
+                    b[v >> 6] |= uint64_t(1) << (v & 63);
+                }
+            }
+        }
+    }
+
+    //是bitmap就直接返回自己的位, 否则展开到tmp里
+    const uint64_t* bitmapView(vector<uint64_t>& tmp) const
+    {
+        if(type == BITMAP)
+        {
+            return bits.data();
+        }
+        tmp.assign(BITMAP_WORDS, 0);
+        fillBitmap(tmp.data());
+        return tmp.data();
+    }
+
+    void toBitmap()
+    {
+        if(type == BITMAP)
+        {
+            return;
+        }
+        vector<uint64_t> b(BITMAP_WORDS, 0);
+        fillBitmap(b.data());
+        bits.swap(b);
+        vector<uint16_t>().swap(array);
+        vector<pair<uint16_t, uint16_t>>().swap(runs);
+        type = BITMAP;
+    }
+
+    void toArray()
+    {
+        if(type == ARRAY)
+        {
+            return;
+        }
+        vector<uint16_t> a;
+        a.reserve(card);
+        forEach([&a](uint16_t v) { a.push_back(v); });
+        array.swap(a);
+        vector<uint64_t>().swap(bits);
+        vector<pair<uint16_t, uint16_t>>().swap(runs);
+        type = ARRAY;
+    }
+
+    //按元素个数选择array或bitmap
+    void normalize()
+    {
+        if(type == ARRAY && card > ARRAY_MAX)
+        {
+            toBitmap();
+        }
+        else if(type == BITMAP && card <= ARRAY_MAX)
+        {
+            toArray();
+        }
+    }
+
+    bool insert(uint16_t v)
+    {
+        if(type == RUN)
+        {
+            if(contains(v))
+            {
+                return false;
+            }
+            card <= ARRAY_MAX ? toArray() : toBitmap();
+        }
+        if(type == ARRAY)
+        {
+            vector<uint16_t>::iterator it = lower_bound(array.begin(), array.end(), v);
+            if(it != array.end() && *it == v)
+            {
+                return false;
+            }
+            array.insert(it, v);
+            card++;
+            normalize();
+            return true;
+        }
+        uint64_t mask = uint64_t(1) << (v & 63);
+        if(bits[v >> 6] & mask)
+        {
+            return false;
+        }
+        bits[v >> 6] |= mask;
+        card++;
+        return true;
+    }
+
+    bool erase(uint16_t v)
+    {
+        if(!contains(v))
+        {
+            return false;
+        }
+        if(type == RUN)
+        {
+            card <= ARRAY_MAX ? toArray() : toBitmap();
+        }
+        if(type == ARRAY)
+        {
+            array.erase(lower_bound(array.begin(), array.end(), v));
+        }
+        else
+        {
+            bits[v >> 6] &= ~(uint64_t(1) << (v & 63));
+        }
+        card--;
+        normalize();
+        return true;
+    }
+
+    //连续段比较多时转成run, 返回是否转换了
+    bool runOptimize()
+    {
+        vector<pair<uint16_t, uint16_t>> r;
+        bool open = false;
+        uint32_t prev = 0;
+        forEach([&](uint16_t v)
+        {
+            if(open && v == prev + 1)
+            {
+                r.back().second++;
+            }
+            else
+            {
+                r.push_back(make_pair(v, uint16_t(0)));
+                open = true;
+            }
+            prev = v;
+        });
+        size_t current = type == ARRAY ? array.size() * 2 : (type == BITMAP ? BITMAP_WORDS * 8 : runs.size() * 4);
+        if(r.size() * 4 >= current)
+        {
+            return false;
+        }
+        runs.swap(r);
+        vector<uint16_t>().swap(array);
+        vector<uint64_t>().swap(bits);
+        type = RUN;
+        return true;
+    }
+
+    template<class F>
+    void forEach(F f) const
+    {
+        if(type == ARRAY)
+        {
+            for(size_t i = 0; i<array.size(); i++)
+            {
+                f(array[i]);
+            }
+        }
+        else if(type == BITMAP)
+        {
+            for(size_t i = 0; i<BITMAP_WORDS; i++)
+            {
+                uint64_t w = bits[i];
+                while(w != 0)
+                {
+                    f(uint16_t(i * 64 + __builtin_ctzll(w)));
+                    w &= w - 1;
+                }
+            }
+        }
+        else
+        {
+            for(size_t i = 0; i<runs.size(); i++)
+            {
+                uint32_t last = uint32_t(runs[i].first) + runs[i].second;
+                for(uint32_t v = runs[i].first; v <= last; v++)
+                {
+                    f(uint16_t(v));
+                }
+            }
+        }
+    }
+
+    template<class F>
+    void forEachReverse(F f) const
+    {
+        if(type == ARRAY)
+        {
+            for(size_t i = array.size(); i-- > 0; )
+            {
+                f(array[i]);
+            }
+        }
+        else if(type == BITMAP)
+        {
+            for(size_t i = BITMAP_WORDS; i-- > 0; )
+            {
+                uint64_t w = bits[i];
+                while(w != 0)
+                {
+                    int top = 63 - __builtin_clzll(w);
+                    f(uint16_t(i * 64 + top));
+                    w &= ~(uint64_t(1) << top);
+                }
+            }
+        }
+        else
+        {
+            for(size_t i = runs.size(); i-- > 0; )
+            {
+                for(uint32_t v = uint32_t(runs[i].first) + runs[i].second + 1; v-- > runs[i].first; )
+                {
+                    f(uint16_t(v));
+                }
+            }
+        }
+    }
+
+    size_t bytes() const
+    {
+        return array.capacity() * 2 + bits.capacity() * 8 + runs.capacity() * 4;
+    }
+};
+
+enum setOp { OP_OR, OP_AND, OP_ANDNOT };
+
+//----------------bitmap内核: out = a op b, 返回out里1的个数----------------
+
+template<setOp OP>
+static inline uint64_t applyOp(uint64_t a, uint64_t b)
+{
+    return OP == OP_OR ? (a | b) : (OP == OP_AND ? (a & b) : (a & ~b));
+}
+
+template<setOp OP>
+static uint32_t bitmapOpScalar(const uint64_t* __restrict a, const uint64_t* __restrict b, uint64_t* __restrict out)
+{
+    uint32_t card = 0;
+    for(size_t i = 0; i<BITMAP_WORDS; i++)
+    {
+        out[i] = applyOp<OP>(a[i], b[i]);
+        card += __builtin_popcountll(out[i]);
+    }
+    return card;
+}
+
+#ifdef ROARING_X86
+template<setOp OP>
+__attribute__((target("avx2")))
+static inline __m256i applyOpAvx2(__m256i a, __m256i b)
+{
+    return OP == OP_OR ? _mm256_or_si256(a, b) : (OP == OP_AND ? _mm256_and_si256(a, b) : _mm256_andnot_si256(b, a));
+}
+
+//AVX2没有popcnt指令: 每个字节拆成高低4位, 用shuffle查16项的表得到各自1的个数, 再用sad把字节加到64位里
+template<setOp OP>
+__attribute__((target("avx2")))
+static uint32_t bitmapOpAvx2(const uint64_t* a, const uint64_t* b, uint64_t* out)
+{
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i total = _mm256_setzero_si256();
+    for(size_t i = 0; i<BITMAP_WORDS; i += 4)
+    {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i v = applyOpAvx2<OP>(x, y);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+        __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low));
+        __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+    }
+    uint64_t t[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(t), total);
+    return uint32_t(t[0] + t[1] + t[2] + t[3]);
+}
+#endif
+
+struct bitmapKernels
+{
+    uint32_t (*op[3])(const uint64_t*, const uint64_t*, uint64_t*);
+    const char* name;
+};
+
+static bitmapKernels pickBitmapKernels()
+{
+    bitmapKernels k = { { bitmapOpScalar<OP_OR>, bitmapOpScalar<OP_AND>, bitmapOpScalar<OP_ANDNOT> }, "scalar" };
+#ifdef ROARING_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        k.op[OP_OR] = bitmapOpAvx2<OP_OR>;
+        k.op[OP_AND] = bitmapOpAvx2<OP_AND>;
+        k.op[OP_ANDNOT] = bitmapOpAvx2<OP_ANDNOT>;
+        k.name = "avx2";
+    }
+#endif
+    return k;
+}
+
+static const bitmapKernels& bitmapOps()
+{
+    static bitmapKernels k = pickBitmapKernels();
+    return k;
+}
+
+//两个块做集合运算, 两边都是array时归并, 否则转成bitmap按字运算
+container combine(const container& a, const container& b, setOp op)
+{
+    container out;
+    if(a.type == ARRAY && b.type == ARRAY)
+    {
+        if(op == OP_OR)
+        {
+            set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(out.array));
+        }
+        else if(op == OP_AND)
+        {
+            set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(out.array));
+        }
+        else
+        {
+            set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(out.array));
+        }
+        out.card = uint32_t(out.array.size());
+        out.normalize();
+        return out;
+    }
+
+    //array和其他类型求交集/差集时, 结果不会比array多, 逐个检查即可
+    if(a.type == ARRAY && op != OP_OR)
+    {
+        for(size_t i = 0; i<a.array.size(); i++)
+        {
+            if(b.contains(a.array[i]) == (op == OP_AND))
+            {
+                out.array.push_back(a.array[i]);
+            }
+        }
+        out.card = uint32_t(out.array.size());
+        return out;
+    }
+    if(b.type == ARRAY && op == OP_AND)
+    {
+        return combine(b, a, op);
+    }
+
+    vector<uint64_t> tmpA;
+    vector<uint64_t> tmpB;
+    const uint64_t* pa = a.bitmapView(tmpA);
+    const uint64_t* pb = b.bitmapView(tmpB);
+    out.type = BITMAP;
+    out.bits.resize(BITMAP_WORDS);
+    out.card = bitmapOps().op[op](pa, pb, out.bits.data());
+    out.normalize();
+    return out;
+}
+
+class roaring
+{
+public:
+    bool insert(uint32_t x)
+    {
+        return getOrCreate(uint16_t(x >> 16)).insert(uint16_t(x));
+    }
+
+    bool contains(uint32_t x) const
+    {
+        int i = findChunk(uint16_t(x >> 16));
+        return i >= 0 && conts[i].contains(uint16_t(x));
+    }
+
+    bool erase(uint32_t x)
+    {
+        int i = findChunk(uint16_t(x >> 16));
+        if(i < 0 || !conts[i].erase(uint16_t(x)))
+        {
+            return false;
+        }
+        if(conts[i].card == 0)
+        {
+            keys.erase(keys.begin() + i);
+            conts.erase(conts.begin() + i);
+        }
+        return true;
+    }
+
+    size_t size() const
+    {
+        size_t n = 0;
+        for(size_t i = 0; i<conts.size(); i++)
+        {
+            n += conts[i].card;
+        }
+        return n;
+    }
+
+    void runOptimize()
+    {
+        for(size_t i = 0; i<conts.size(); i++)
+        {
+            conts[i].runOptimize();
+        }
+    }
+
+    //从小到大
+    template<class F>
+    void forEach(F f) const
+    {
+        for(size_t i = 0; i<conts.size(); i++)
+        {
+            uint32_t high = uint32_t(keys[i]) << 16;
+            conts[i].forEach([&](uint16_t low) { f(high | low); });
+        }
+    }
+
+    //从大到小
+    template<class F>
+    void forEachReverse(F f) const
+    {
+        for(size_t i = conts.size(); i-- > 0; )
+        {
+            uint32_t high = uint32_t(keys[i]) << 16;
+            conts[i].forEachReverse([&](uint16_t low) { f(high | low); });
+        }
+    }
+
+    size_t bytes() const
+    {
+        size_t n = keys.capacity() * 2 + conts.capacity() * sizeof(container);
+        for(size_t i = 0; i<conts.size(); i++)
+        {
+            n += conts[i].bytes();
+        }
+        return n;
+    }
+
+    friend roaring operator|(const roaring& a, const roaring& b) { return merge(a, b, OP_OR); }
+    friend roaring operator&(const roaring& a, const roaring& b) { return merge(a, b, OP_AND); }
+    friend roaring operator-(const roaring& a, const roaring& b) { return merge(a, b, OP_ANDNOT); }
+
+private:
+    int findChunk(uint16_t high) const
+    {
+        vector<uint16_t>::const_iterator it = lower_bound(keys.begin(), keys.end(), high);
+        if(it != keys.end() && *it == high)
+        {
+            return int(it - keys.begin());
+        }
+        return -1;
+    }
+
+    container& getOrCreate(uint16_t high)
+    {
+        vector<uint16_t>::iterator it = lower_bound(keys.begin(), keys.end(), high);
+        size_t i = it - keys.begin();
+        if(it == keys.end() || *it != high)
+        {
+            keys.insert(it, high);
+            conts.insert(conts.begin() + i, container());
+        }
+        return conts[i];
+    }
+
+    void append(uint16_t high, container&& c)
+    {
+        if(c.card > 0)
+        {
+            keys.push_back(high);
+            conts.push_back(std::move(c));
+        }
+    }
+
+    //按块号归并两边的块
+    static roaring merge(const roaring& a, const roaring& b, setOp op)
+    {
+        roaring out;
+        size_t i = 0;
+        size_t j = 0;
+        while(i < a.keys.size() || j < b.keys.size())
+        {
+            if(j == b.keys.size() || (i < a.keys.size() && a.keys[i] < b.keys[j]))
+            {
+                if(op != OP_AND)
+                {
+                    out.append(a.keys[i], container(a.conts[i]));
+                }
+                i++;
+            }
+            else if(i == a.keys.size() || b.keys[j] < a.keys[i])
+            {
+                if(op == OP_OR)
+                {
+                    out.append(b.keys[j], container(b.conts[j]));
+                }
+                j++;
+            }
+            else
+            {
+                out.append(a.keys[i], combine(a.conts[i], b.conts[j], op));
+                i++;
+                j++;
+            }
+        }
+        return out;
+    }
+
+    vector<uint16_t> keys;
+    vector<container> conts;
+};
+
+class myCompar
+{
+public:
+    bool operator()(int a, int b) const
+    {
+       return a > b;
+    }
+};
+
+void test01()
+{
+    set<int, myCompar>s1;
+    roaring r1;
+    for(int i = 0; i<10; i++)
+    {
+        s1.insert(10+i);
+        r1.insert(10+i);
+    }
+
+    for(set<int, myCompar>:: iterator it = s1.begin(); it != s1.end(); it++)
+    {
+        cout<<*it<<" ";
+    }
+    cout<<endl;
+
+    //和myCompar一样从大到小
+    r1.forEachReverse([](uint32_t v) { cout<<v<<" "; });
+    cout<<endl;
+
+    roaring r2;
+    for(int i = 15; i<25; i++)
+    {
+        r2.insert(i);
+    }
+    r2.insert(100000);
+
+    cout<<"or    :";
+    (r1 | r2).forEach([](uint32_t v) { cout<<" "<<v; });
+    cout<<endl<<"and   :";
+    (r1 & r2).forEach([](uint32_t v) { cout<<" "<<v; });
+    cout<<endl<<"andnot:";
+    (r1 - r2).forEach([](uint32_t v) { cout<<" "<<v; });
+    cout<<endl;
+    cout<<"contains 100000: "<<r2.contains(100000)<<", contains 99999: "<<r2.contains(99999)<<endl;
+}
+
+void test02()
+{
+    //检查三种块和集合运算的结果跟std::set一致
+    mt19937 rng(1);
+    set<uint32_t> sa;
+    set<uint32_t> sb;
+    roaring ra;
+    roaring rb;
+    for(int i = 0; i<200000; i++)
+    {
+        uint32_t x = rng() % 400000;
+        uint32_t y = (i < 100000) ? uint32_t(i + 150000) : rng() % 400000;
+        sa.insert(x);
+        ra.insert(x);
+        sb.insert(y);
+        rb.insert(y);
+    }
+    for(int i = 0; i<5000; i++)
+    {
+        uint32_t x = rng() % 400000;
+        sa.erase(x);
+        ra.erase(x);
+    }
+    rb.runOptimize();
+
+    vector<uint32_t> expect;
+    vector<uint32_t> got;
+    bool ok = true;
+
+    set_union(sa.begin(), sa.end(), sb.begin(), sb.end(), back_inserter(expect));
+    (ra | rb).forEach([&got](uint32_t v) { got.push_back(v); });
+    ok = ok && expect == got;
+
+    expect.clear();
+    got.clear();
+    set_intersection(sa.begin(), sa.end(), sb.begin(), sb.end(), back_inserter(expect));
+    (ra & rb).forEach([&got](uint32_t v) { got.push_back(v); });
+    ok = ok && expect == got;
+
+    expect.clear();
+    got.clear();
+    set_difference(sa.begin(), sa.end(), sb.begin(), sb.end(), back_inserter(expect));
+    (ra - rb).forEach([&got](uint32_t v) { got.push_back(v); });
+    ok = ok && expect == got;
+
+    expect.assign(sb.rbegin(), sb.rend());
+    got.clear();
+    rb.forEachReverse([&got](uint32_t v) { got.push_back(v); });
+    ok = ok && expect == got;
+
+    cout<<"check against std::set: "<<(ok ? "ok" : "FAILED")<<endl;
+}
+
+void test03()
+{
+    //两千万个ID, 大部分连续, 夹杂一些随机的
+    const uint32_t n = 20000000;
+    mt19937 rng(3);
+    roaring a;
+    roaring b;
+    auto t0 = chrono::steady_clock::now();
+    for(uint32_t i = 0; i<n; i++)
+    {
+        a.insert(i + (rng() % 8 == 0 ? 1 : 0) * 50000000);
+        if(i % 3 != 0)
+        {
+            b.insert(i);
+        }
+    }
+    auto t1 = chrono::steady_clock::now();
+    a.runOptimize();
+    auto t2 = chrono::steady_clock::now();
+    roaring u = a | b;
+    roaring x = a & b;
+    roaring d = a - b;
+    auto t3 = chrono::steady_clock::now();
+
+    cout<<"insert "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms, runOptimize "
+        <<chrono::duration<double, milli>(t2 - t1).count()<<" ms, or/and/andnot "
+        <<chrono::duration<double, milli>(t3 - t2).count()<<" ms"<<endl;
+    cout<<"a: "<<a.size()<<" ids in "<<a.bytes() / 1024<<" KB, b: "<<b.size()<<" ids in "<<b.bytes() / 1024
+        <<" KB (std::set needs about "<<(a.size() + b.size()) * 40 / (1024 * 1024)<<" MB)"<<endl;
+    cout<<"or "<<u.size()<<", and "<<x.size()<<", andnot "<<d.size()<<endl;
+
+    //两个bitmap块直接运算, 不再先各拷贝一份
+    container ca;
+    container cb;
+    for(uint32_t v = 0; v<65536; v++)
+    {
+        if(rng() % 3 == 0)
+        {
+            ca.insert(uint16_t(v));
+        }
+        if(rng() % 2 == 0)
+        {
+            cb.insert(uint16_t(v));
+        }
+    }
+    const int reps = 200000;
+    uint64_t cards = 0;
+    auto t4 = chrono::steady_clock::now();
+    for(int r = 0; r<reps; r++)
+    {
+        cards += combine(ca, cb, setOp(r % 3)).card;
+    }
+    auto t5 = chrono::steady_clock::now();
+    cout<<"bitmap x bitmap ("<<bitmapOps().name<<") "<<reps<<" ops: "<<chrono::duration<double, milli>(t5 - t4).count()
+        <<" ms, total cardinality "<<cards<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+    test03();
+    system("pause");
+
+}
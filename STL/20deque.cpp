@@ -0,0 +1,396 @@
+#include<iostream>
+#include<deque>
+#include<vector>
+#include<string>
+#include<atomic>
+#include<thread>
+#include<chrono>
+#include<new>
+#include<utility>
+#include<cstddef>
+using namespace std;
+
+//环形缓冲区实现的双端队列, 以及基于同样布局的单生产者单消费者无锁队列
+//容量总是2的幂, 下标用 & (容量-1) 回绕, 满了以后容量翻倍并把数据摆正
+
+template<class T>
+class ringDeque
+{
+public:
+    ringDeque() : buf(NULL), cap(0), head(0), len(0) {}
+
+    explicit ringDeque(size_t n, const T& value = T()) : ringDeque()
+    {
+        reserve(n);
+        for(size_t i = 0; i<n; i++)
+        {
+            push_back(value);
+        }
+    }
+
+    ringDeque(const ringDeque& r) : ringDeque()
+    {
+        reserve(r.len);
+        for(size_t i = 0; i<r.len; i++)
+        {
+            push_back(r[i]);
+        }
+    }
+
+    ringDeque(ringDeque&& r) noexcept : buf(r.buf), cap(r.cap), head(r.head), len(r.len)
+    {
+        r.buf = NULL;
+        r.cap = r.head = r.len = 0;
+    }
+
+    ringDeque& operator=(ringDeque r)
+    {
+        swap(buf, r.buf);
+        swap(cap, r.cap);
+        swap(head, r.head);
+        swap(len, r.len);
+        return *this;
+    }
+
+    ~ringDeque()
+    {
+        clear();
+        ::operator delete(buf);
+    }
+
+    size_t size() const { return len; }
+    size_t capacity() const { return cap; }
+    bool empty() const { return len == 0; }
+
+    T& operator[](size_t i) { return buf[(head + i) & (cap - 1)]; }
+    const T& operator[](size_t i) const { return buf[(head + i) & (cap - 1)]; }
+    T& front() { return buf[head]; }
+    const T& front() const { return buf[head]; }
+    T& back() { return (*this)[len - 1]; }
+    const T& back() const { return (*this)[len - 1]; }
+
+    void push_back(const T& v)
+    {
+        if(len == cap)
+        {
+            //v可能就是自己里面的元素, 先拷出来再扩容
+            T tmp(v);
+            grow(cap == 0 ? 8 : cap * 2);
+            new(&buf[(head + len) & (cap - 1)]) T(std::move(tmp));
+        }
+        else
+        {
+            new(&buf[(head + len) & (cap - 1)]) T(v);
+        }
+        len++;
+    }
+
+    void push_front(const T& v)
+    {
+        if(len == cap)
+        {
+            T tmp(v);
+            grow(cap == 0 ? 8 : cap * 2);
+            head = (head - 1) & (cap - 1);
+            new(&buf[head]) T(std::move(tmp));
+        }
+        else
+        {
+            head = (head - 1) & (cap - 1);
+            new(&buf[head]) T(v);
+        }
+        len++;
+    }
+
+    void pop_back()
+    {
+        len--;
+        buf[(head + len) & (cap - 1)].~T();
+    }
+
+    void pop_front()
+    {
+        buf[head].~T();
+        head = (head + 1) & (cap - 1);
+        len--;
+    }
+
+    void clear()
+    {
+        while(len > 0)
+        {
+            pop_back();
+        }
+        head = 0;
+    }
+
+    void reserve(size_t n)
+    {
+        if(n > cap)
+        {
+            size_t c = 8;
+            while(c < n)
+            {
+                c *= 2;
+            }
+            grow(c);
+        }
+    }
+
+    //数据最多分成两段连续内存: [head, 缓冲区末尾) 和 [0, 回绕的部分)
+    //批量拷贝时按段memcpy/copy, 不用逐个元素算下标
+    pair<pair<T*, size_t>, pair<T*, size_t>> segments()
+    {
+        size_t first = min(len, cap - head);
+        return make_pair(make_pair(buf + head, first), make_pair(buf, len - first));
+    }
+
+    template<class OutIt>
+    OutIt copyTo(OutIt out)
+    {
+        pair<pair<T*, size_t>, pair<T*, size_t>> s = segments();
+        out = copy(s.first.first, s.first.first + s.first.second, out);
+        return copy(s.second.first, s.second.first + s.second.second, out);
+    }
+
+private:
+    void grow(size_t newCap)
+    {
+        T* nb = static_cast<T*>(::operator new(newCap * sizeof(T)));
+        for(size_t i = 0; i<len; i++)
+        {
+            T& src = buf[(head + i) & (cap - 1)];
+            new(&nb[i]) T(std::move(src));
+            src.~T();
+        }
+        ::operator delete(buf);
+        buf = nb;
+        cap = newCap;
+        head = 0;
+    }
+
+    T* buf;
+    size_t cap;
+    size_t head;
+    size_t len;
+};
+
+//单生产者单消费者队列
+//生产者只写tail, 消费者只写head, 两个下标各占一个缓存行, 避免互相把对方的缓存行作废
+//每一方还缓存一份对方的下标, 只有看起来满/空时才去读对方的原子变量
+//push和pop都不会阻塞也不会重试, 失败立即返回false
+template<class T>
+class spscQueue
+{
+public:
+    explicit spscQueue(size_t capacity)
+    {
+        size_t c = 2;
+        while(c < capacity)
+        {
+            c *= 2;
+        }
+        mask = c - 1;
+        buf = static_cast<T*>(::operator new(c * sizeof(T)));
+    }
+
+    ~spscQueue()
+    {
+        T v;
+        while(try_pop(v))
+        {
+        }
+        ::operator delete(buf);
+    }
+
+    spscQueue(const spscQueue&) = delete;
+    spscQueue& operator=(const spscQueue&) = delete;
+
+    //只能在生产者线程调用
+    bool try_push(const T& v)
+    {
+        size_t t = prod.tail.load(memory_order_relaxed);
+        if(t - prod.cachedHead > mask)
+        {
+            prod.cachedHead = cons.head.load(memory_order_acquire);
+            if(t - prod.cachedHead > mask)
+            {
+                return false;
+            }
+        }
+        new(&buf[t & mask]) T(v);
+        prod.tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    //只能在消费者线程调用
+    bool try_pop(T& out)
+    {
+        size_t h = cons.head.load(memory_order_relaxed);
+        if(h == cons.cachedTail)
+        {
+            cons.cachedTail = prod.tail.load(memory_order_acquire);
+            if(h == cons.cachedTail)
+            {
+                return false;
+            }
+        }
+        T& slot = buf[h & mask];
+        out = std::move(slot);
+        slot.~T();
+        cons.head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+private:
+    struct alignas(64) producerSide
+    {
+        atomic<size_t> tail{0};
+        size_t cachedHead = 0;
+    };
+
+    struct alignas(64) consumerSide
+    {
+        atomic<size_t> head{0};
+        size_t cachedTail = 0;
+    };
+
+    producerSide prod;
+    consumerSide cons;
+    alignas(64) T* buf;
+    size_t mask;
+};
+
+void printDeque(ringDeque<int>& q)
+{
+    for(size_t i = 0; i<q.size(); i++)
+    {
+        cout<<q[i]<<" ";
+    }
+    cout<<endl;
+}
+
+void test01()
+{
+    ringDeque<int> d1;
+    for(int i = 0; i<5; i++)
+    {
+        d1.push_back(i);
+    }
+    for(int i = 0; i<5; i++)
+    {
+        d1.push_front(-i - 1);
+    }
+    printDeque(d1);
+
+    ringDeque<int> d3(10, 100);
+    printDeque(d3);
+    ringDeque<int> d4(d3);
+    d4.pop_front();
+    d4.pop_back();
+    printDeque(d4);
+
+    //在回绕状态下按段拷出来
+    vector<int> out(d1.size());
+    d1.copyTo(out.begin());
+    cout<<"segments "<<d1.segments().first.second<<" + "<<d1.segments().second.second<<":";
+    for(size_t i = 0; i<out.size(); i++)
+    {
+        cout<<" "<<out[i];
+    }
+    cout<<endl;
+
+    //满的时候把自己的元素再放进去, 扩容以后拷贝的仍然是原来的值
+    ringDeque<string> d5;
+    for(int i = 0; i<8; i++)
+    {
+        d5.push_back("s" + to_string(i));
+    }
+    d5.push_back(d5[0]);
+    d5.push_front(d5.back());
+    const ringDeque<string>& cd5 = d5;
+    cout<<"size "<<cd5.size()<<" capacity "<<cd5.capacity()<<", front "<<cd5.front()<<", back "<<cd5.back()<<endl;
+}
+
+void test02()
+{
+    const int n = 20000000;
+
+    //先进先出的滑动窗口: 后面进, 前面出
+    auto t0 = chrono::steady_clock::now();
+    deque<int> sd;
+    long long s1 = 0;
+    for(int i = 0; i<n; i++)
+    {
+        sd.push_back(i);
+        if(sd.size() > 1000)
+        {
+            s1 += sd.front();
+            sd.pop_front();
+        }
+    }
+    auto t1 = chrono::steady_clock::now();
+    ringDeque<int> rd;
+    long long s2 = 0;
+    for(int i = 0; i<n; i++)
+    {
+        rd.push_back(i);
+        if(rd.size() > 1000)
+        {
+            s2 += rd.front();
+            rd.pop_front();
+        }
+    }
+    auto t2 = chrono::steady_clock::now();
+
+    cout<<"window std::deque "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms, ringDeque "
+        <<chrono::duration<double, milli>(t2 - t1).count()<<" ms ("<<(s1 == s2 ? "same" : "DIFFERENT")<<")"<<endl;
+}
+
+void test03()
+{
+    const long long n = 20000000;
+    spscQueue<long long> q(1024);
+
+    auto t0 = chrono::steady_clock::now();
+    thread producer([&q, n]()
+    {
+        for(long long i = 0; i<n; i++)
+        {
+            while(!q.try_push(i))
+            {
+                this_thread::yield();
+            }
+        }
+    });
+
+    long long sum = 0;
+    long long expect = 0;
+    bool ordered = true;
+    for(long long i = 0; i<n; i++)
+    {
+        long long v;
+        while(!q.try_pop(v))
+        {
+            this_thread::yield();
+        }
+        ordered = ordered && v == expect;
+        expect++;
+        sum += v;
+    }
+    producer.join();
+    auto t1 = chrono::steady_clock::now();
+
+    double ms = chrono::duration<double, milli>(t1 - t0).count();
+    cout<<"spsc "<<n<<" items in "<<ms<<" ms ("<<n / ms / 1000<<" M/s), sum "
+        <<(sum == n * (n - 1) / 2 && ordered ? "ok" : "WRONG")<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+    test03();
+
+    system("pause");
+}
@@ -0,0 +1,436 @@
+#include<iostream>
+#include<stack>
+#include<vector>
+#include<atomic>
+#include<thread>
+#include<mutex>
+#include<chrono>
+#include<cstdint>
+#include<type_traits>
+using namespace std;
+
+//并发的后进先出结构
+//workStealingDeque: Chase-Lev工作窃取队列, 所有者在底部push/pop(后进先出), 其他线程从顶部steal
+//treiberStack: 无锁栈, 节点来自固定大小的节点池, 栈顶是(下标, 版本号)拼成的64位整数,
+//              每次修改版本号加一, 避免ABA问题; 节点不会被释放, 读已经弹出的节点也是安全的
+
+template<class T>
+class workStealingDeque
+{
+    static_assert(is_trivially_copyable<T>::value, "workStealingDeque needs trivially copyable T");
+
+    struct ring
+    {
+        int64_t cap;
+        atomic<T>* items;
+        ring* prev;     //扩容前的旧数组, 可能还有窃取者在读, 析构时统一释放
+
+        explicit ring(int64_t c, ring* p) : cap(c), items(new atomic<T>[c]), prev(p) {}
+        ~ring() { delete[] items; }
+
+        T get(int64_t i) const { return items[i & (cap - 1)].load(memory_order_relaxed); }
+        void put(int64_t i, T v) { items[i & (cap - 1)].store(v, memory_order_relaxed); }
+    };
+
+public:
+    //下标用i & (cap - 1)取模, 容量向上取成2的幂, 至少是2
+    explicit workStealingDeque(int64_t capacity = 1024) : top(0), bottom(0), array(new ring(roundUp(capacity), NULL)) {}
+
+    ~workStealingDeque()
+    {
+        ring* r = array.load(memory_order_relaxed);
+        while(r != NULL)
+        {
+            ring* p = r->prev;
+            delete r;
+            r = p;
+        }
+    }
+
+    workStealingDeque(const workStealingDeque&) = delete;
+    workStealingDeque& operator=(const workStealingDeque&) = delete;
+
+    //只能由所有者线程调用
+    void push(T v)
+    {
+        int64_t b = bottom.load(memory_order_relaxed);
+        int64_t t = top.load(memory_order_acquire);
+        ring* a = array.load(memory_order_relaxed);
+        if(b - t > a->cap - 1)
+        {
+            ring* bigger = new ring(a->cap * 2, a);
+            for(int64_t i = t; i<b; i++)
+            {
+                bigger->put(i, a->get(i));
+            }
+            array.store(bigger, memory_order_release);
+            a = bigger;
+        }
+        a->put(b, v);
+        atomic_thread_fence(memory_order_release);
+        bottom.store(b + 1, memory_order_relaxed);
+    }
+
+    //只能由所有者线程调用
+    bool pop(T& out)
+    {
+        int64_t b = bottom.load(memory_order_relaxed) - 1;
+        ring* a = array.load(memory_order_relaxed);
+        bottom.store(b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t t = top.load(memory_order_relaxed);
+        if(t > b)
+        {
+            bottom.store(b + 1, memory_order_relaxed);
+            return false;
+        }
+        out = a->get(b);
+        if(t == b)
+        {
+            //只剩最后一个, 和窃取者抢
+            bool won = top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+            bottom.store(b + 1, memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    //任何线程都可以调用, 失败(空或者抢输了)返回false
+    bool steal(T& out)
+    {
+        int64_t t = top.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t b = bottom.load(memory_order_acquire);
+        if(t >= b)
+        {
+            return false;
+        }
+        ring* a = array.load(memory_order_acquire);
+        T v = a->get(t);
+        if(!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        {
+            return false;
+        }
+        out = v;
+        return true;
+    }
+
+    int64_t sizeApprox() const
+    {
+        return bottom.load(memory_order_relaxed) - top.load(memory_order_relaxed);
+    }
+
+private:
+    static int64_t roundUp(int64_t capacity)
+    {
+        int64_t c = 2;
+        while(c < capacity)
+        {
+            c *= 2;
+        }
+        return c;
+    }
+
+    alignas(64) atomic<int64_t> top;
+    alignas(64) atomic<int64_t> bottom;
+    alignas(64) atomic<ring*> array;
+};
+
+template<class T>
+class treiberStack
+{
+    static const uint32_t NIL = 0xFFFFFFFFu;
+
+    struct node
+    {
+        T value;
+        atomic<uint32_t> next;
+    };
+
+public:
+    explicit treiberStack(uint32_t capacity) : nodes(new node[capacity]), head(pack(NIL, 0)), freeList(pack(NIL, 0))
+    {
+        //一开始所有节点都在空闲链表里
+        for(uint32_t i = 0; i<capacity; i++)
+        {
+            nodes[i].next.store(i + 1 < capacity ? i + 1 : NIL, memory_order_relaxed);
+        }
+        freeList.store(pack(capacity > 0 ? 0 : NIL, 0), memory_order_relaxed);
+    }
+
+    ~treiberStack()
+    {
+        delete[] nodes;
+    }
+
+    treiberStack(const treiberStack&) = delete;
+    treiberStack& operator=(const treiberStack&) = delete;
+
+    //节点池用完时返回false
+    bool push(const T& v)
+    {
+        uint32_t idx = popIndex(freeList);
+        if(idx == NIL)
+        {
+            return false;
+        }
+        nodes[idx].value = v;
+        pushIndex(head, idx);
+        return true;
+    }
+
+    bool pop(T& out)
+    {
+        uint32_t idx = popIndex(head);
+        if(idx == NIL)
+        {
+            return false;
+        }
+        out = nodes[idx].value;
+        pushIndex(freeList, idx);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return index(head.load(memory_order_acquire)) == NIL;
+    }
+
+private:
+    static uint64_t pack(uint32_t idx, uint32_t tag) { return (uint64_t(tag) << 32) | idx; }
+    static uint32_t index(uint64_t v) { return uint32_t(v); }
+    static uint32_t tag(uint64_t v) { return uint32_t(v >> 32); }
+
+    void pushIndex(atomic<uint64_t>& top, uint32_t idx)
+    {
+        uint64_t old = top.load(memory_order_relaxed);
+        do
+        {
+            nodes[idx].next.store(index(old), memory_order_relaxed);
+        }
+        while(!top.compare_exchange_weak(old, pack(idx, tag(old) + 1), memory_order_release, memory_order_relaxed));
+    }
+
+    uint32_t popIndex(atomic<uint64_t>& top)
+    {
+        uint64_t old = top.load(memory_order_acquire);
+        while(index(old) != NIL)
+        {
+            //就算这个节点已经被别人弹出, 读到的next也只是旧值, 版本号不同CAS会失败
+            uint32_t next = nodes[index(old)].next.load(memory_order_relaxed);
+            if(top.compare_exchange_weak(old, pack(next, tag(old) + 1), memory_order_acquire, memory_order_acquire))
+            {
+                return index(old);
+            }
+        }
+        return NIL;
+    }
+
+    node* nodes;
+    alignas(64) atomic<uint64_t> head;
+    alignas(64) atomic<uint64_t> freeList;
+};
+
+void test01()
+{
+    //单线程时两者都和stack<int>一样后进先出
+    workStealingDeque<int> dq(4);
+    treiberStack<int> ts(16);
+    for( int i = 0; i<10; i++)
+    {
+        dq.push(i+10);
+        ts.push(i+10);
+    }
+
+    int v = 0;
+    dq.steal(v);
+    cout<<"stolen from top: "<<v<<endl;
+    while(dq.pop(v))
+    {
+        cout<<v<<" ";
+    }
+    cout<<endl;
+    while(ts.pop(v))
+    {
+        cout<<v<<" ";
+    }
+    cout<<endl;
+
+    //容量不是2的幂或者是0时会被取整
+    workStealingDeque<int> odd(5);
+    workStealingDeque<int> zero(0);
+    for( int i = 0; i<12; i++)
+    {
+        odd.push(i);
+        zero.push(i);
+    }
+    int w = 0;
+    bool same = true;
+    while(odd.pop(v))
+    {
+        same = same && zero.pop(w) && v == w;
+        cout<<v<<" ";
+    }
+    cout<<(same && !zero.pop(w) ? "(same)" : "(DIFFERENT)")<<endl;
+}
+
+//压力测试: 所有者不断push/pop, 窃取者不断steal, 检查每个任务恰好被执行一次
+void test02()
+{
+    const int tasks = 2000000;
+    const int thieves = 3;
+    workStealingDeque<int> dq(64);
+    vector<atomic<int>> done(tasks);
+    for(int i = 0; i<tasks; i++)
+    {
+        done[i].store(0);
+    }
+    atomic<bool> finished(false);
+    atomic<int> stolen(0);
+
+    vector<thread> ts;
+    for(int k = 0; k<thieves; k++)
+    {
+        ts.push_back(thread([&]()
+        {
+            int v;
+            while(!finished.load(memory_order_acquire))
+            {
+                if(dq.steal(v))
+                {
+                    done[v].fetch_add(1);
+                    stolen.fetch_add(1);
+                }
+            }
+        }));
+    }
+
+    int v;
+    for(int i = 0; i<tasks; i++)
+    {
+        dq.push(i);
+        if(i % 3 == 0 && dq.pop(v))
+        {
+            done[v].fetch_add(1);
+        }
+    }
+    while(dq.pop(v))
+    {
+        done[v].fetch_add(1);
+    }
+    //队列已经空了, 窃取者抢到的任务会在退出循环前记完
+    finished.store(true, memory_order_release);
+    for(size_t k = 0; k<ts.size(); k++)
+    {
+        ts[k].join();
+    }
+
+    int bad = 0;
+    for(int i = 0; i<tasks; i++)
+    {
+        bad += done[i].load() != 1;
+    }
+    cout<<"work stealing: "<<tasks<<" tasks, "<<stolen.load()<<" stolen, "
+        <<(bad == 0 ? "each ran once" : "WRONG")<<endl;
+
+    //treiber栈: 多个线程同时push/pop, 最后剩下的加上弹出的应该正好是全部
+    const int threads = 4;
+    const int perThread = 500000;
+    treiberStack<int> st(1024);
+    atomic<long long> popped(0);
+    atomic<long long> pushed(0);
+    vector<thread> ws;
+    for(int k = 0; k<threads; k++)
+    {
+        ws.push_back(thread([&, k]()
+        {
+            long long in = 0;
+            long long out = 0;
+            int x;
+            for(int i = 0; i<perThread; i++)
+            {
+                int value = k * perThread + i;
+                if(st.push(value))
+                {
+                    in += value;
+                }
+                if(st.pop(x))
+                {
+                    out += x;
+                }
+            }
+            pushed.fetch_add(in);
+            popped.fetch_add(out);
+        }));
+    }
+    for(size_t k = 0; k<ws.size(); k++)
+    {
+        ws[k].join();
+    }
+    long long rest = 0;
+    int x;
+    while(st.pop(x))
+    {
+        rest += x;
+    }
+    cout<<"treiber stack: "<<(pushed.load() == popped.load() + rest ? "sum ok" : "WRONG")<<endl;
+}
+
+//竞争测试: 每个线程push一次pop一次, 和加锁的stack<int>比吞吐量
+void test03()
+{
+    const int opsPerThread = 1000000;
+    for(int threads = 1; threads <= 8; threads *= 2)
+    {
+        treiberStack<int> st(4096);
+        stack<int> locked;
+        mutex m;
+
+        auto run = [&](auto body)
+        {
+            auto t0 = chrono::steady_clock::now();
+            vector<thread> ws;
+            for(int k = 0; k<threads; k++)
+            {
+                ws.push_back(thread(body));
+            }
+            for(size_t k = 0; k<ws.size(); k++)
+            {
+                ws[k].join();
+            }
+            auto t1 = chrono::steady_clock::now();
+            return threads * opsPerThread * 2 / chrono::duration<double, micro>(t1 - t0).count();
+        };
+
+        double lockFree = run([&]()
+        {
+            int x;
+            for(int i = 0; i<opsPerThread; i++)
+            {
+                st.push(i);
+                st.pop(x);
+            }
+        });
+        double withLock = run([&]()
+        {
+            for(int i = 0; i<opsPerThread; i++)
+            {
+                {
+                    lock_guard<mutex> g(m);
+                    locked.push(i);
+                }
+                lock_guard<mutex> g(m);
+                locked.pop();
+            }
+        });
+        cout<<threads<<" threads: treiber "<<lockFree<<" Mops/s, mutex+stack "<<withLock<<" Mops/s"<<endl;
+    }
+}
+
+int main()
+{
+    test01();
+    test02();
+    test03();
+    system("pause");
+}
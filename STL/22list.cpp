@@ -0,0 +1,598 @@
+#include<iostream>
+#include<list>
+#include<numeric>
+#include<algorithm>
+#include<iterator>
+#include<chrono>
+#include<new>
+#include<utility>
+#include<type_traits>
+#include<cstddef>
+using namespace std;
+
+//展开链表(unrolled linked list)
+//每个节点连续存放最多NodeCap个元素, 遍历时大部分时间是在顺序读数组, 很少跳指针
+//节点从链表自己的节点池里分配, 节点池一次申请一大块, push_front/push_back基本不会调用new
+//迭代器是(节点, 下标): insert/erase只移动被修改的节点里的元素, 这个节点的迭代器会失效
+//另外insert遇到满节点时对半分裂, 新节点的迭代器也失效; erase把下一个节点并进来时, 下一个节点的迭代器也失效; 更远的节点不受影响
+//splice整条链表只需要改几个指针, 对方的节点池也一起接过来
+
+template<class T, int NodeCap = 32>
+class unrolledList
+{
+    //满节点对半分裂, 两边都不能是空的
+    static_assert(NodeCap >= 2, "NodeCap must be at least 2");
+
+    struct node
+    {
+        node* prev;
+        node* next;
+        int count;
+        alignas(T) unsigned char storage[NodeCap * sizeof(T)];
+
+        T* items() { return reinterpret_cast<T*>(storage); }
+    };
+
+    static const int BLOCK_NODES = 64;
+
+    struct block
+    {
+        block* next;
+        node nodes[BLOCK_NODES];
+    };
+
+    //节点池: 大块之间用链表串起来, 空闲节点也用链表串起来, 两个链表都记尾指针, 合并是O(1)
+    struct nodePool
+    {
+        block* blocks;
+        block* blocksTail;
+        node* freeHead;
+        node* freeTail;
+
+        nodePool() : blocks(NULL), blocksTail(NULL), freeHead(NULL), freeTail(NULL) {}
+
+        ~nodePool()
+        {
+            while(blocks != NULL)
+            {
+                block* b = blocks->next;
+                delete blocks;
+                blocks = b;
+            }
+        }
+
+        node* get()
+        {
+            if(freeHead == NULL)
+            {
+                block* b = new block;
+                b->next = NULL;
+                if(blocksTail != NULL)
+                {
+                    blocksTail->next = b;
+                }
+                else
+                {
+                    blocks = b;
+                }
+                blocksTail = b;
+                for(int i = 0; i<BLOCK_NODES; i++)
+                {
+                    put(&b->nodes[i]);
+                }
+            }
+            node* n = freeHead;
+            freeHead = n->next;
+            if(freeHead == NULL)
+            {
+                freeTail = NULL;
+            }
+            n->prev = n->next = NULL;
+            n->count = 0;
+            return n;
+        }
+
+        void put(node* n)
+        {
+            n->next = NULL;
+            if(freeTail != NULL)
+            {
+                freeTail->next = n;
+            }
+            else
+            {
+                freeHead = n;
+            }
+            freeTail = n;
+        }
+
+        void absorb(nodePool& o)
+        {
+            if(o.blocks != NULL)
+            {
+                if(blocksTail != NULL)
+                {
+                    blocksTail->next = o.blocks;
+                }
+                else
+                {
+                    blocks = o.blocks;
+                }
+                blocksTail = o.blocksTail;
+            }
+            if(o.freeHead != NULL)
+            {
+                if(freeTail != NULL)
+                {
+                    freeTail->next = o.freeHead;
+                }
+                else
+                {
+                    freeHead = o.freeHead;
+                }
+                freeTail = o.freeTail;
+            }
+            o.blocks = o.blocksTail = NULL;
+            o.freeHead = o.freeTail = NULL;
+        }
+    };
+
+public:
+    template<class V>
+    class basicIterator
+    {
+    public:
+        typedef bidirectional_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef V* pointer;
+        typedef V& reference;
+
+        basicIterator() : owner(NULL), nd(NULL), idx(0) {}
+        basicIterator(const unrolledList* o, node* n, int i) : owner(o), nd(n), idx(i) {}
+        //iterator可以转成const_iterator, 反过来不行
+        template<class W, class = typename enable_if<is_same<V, const T>::value && is_same<W, T>::value>::type>
+        basicIterator(const basicIterator<W>& r) : owner(r.owner), nd(r.nd), idx(r.idx) {}
+
+        V& operator*() const { return nd->items()[idx]; }
+        V* operator->() const { return &nd->items()[idx]; }
+
+        basicIterator& operator++()
+        {
+            if(++idx == nd->count)
+            {
+                nd = nd->next;
+                idx = 0;
+            }
+            return *this;
+        }
+
+        basicIterator& operator--()
+        {
+            if(nd == NULL)
+            {
+                nd = owner->tail;
+                idx = nd->count - 1;
+            }
+            else if(idx-- == 0)
+            {
+                nd = nd->prev;
+                idx = nd->count - 1;
+            }
+            return *this;
+        }
+
+        basicIterator operator++(int) { basicIterator t = *this; ++*this; return t; }
+        basicIterator operator--(int) { basicIterator t = *this; --*this; return t; }
+
+        bool operator==(const basicIterator& r) const { return nd == r.nd && idx == r.idx; }
+        bool operator!=(const basicIterator& r) const { return !(*this == r); }
+
+    private:
+        const unrolledList* owner;
+        node* nd;
+        int idx;
+        friend class unrolledList;
+        template<class W> friend class basicIterator;
+    };
+
+    typedef basicIterator<T> iterator;
+    typedef basicIterator<const T> const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    unrolledList() : head(NULL), tail(NULL), len(0) {}
+
+    ~unrolledList()
+    {
+        clear();
+    }
+
+    unrolledList(const unrolledList&) = delete;
+    unrolledList& operator=(const unrolledList&) = delete;
+
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+
+    iterator begin() { return iterator(this, head, 0); }
+    iterator end() { return iterator(this, NULL, 0); }
+    const_iterator begin() const { return const_iterator(this, head, 0); }
+    const_iterator end() const { return const_iterator(this, NULL, 0); }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+
+    T& front() { return head->items()[0]; }
+    T& back() { return tail->items()[tail->count - 1]; }
+
+    void push_back(const T& v)
+    {
+        if(tail == NULL || tail->count == NodeCap)
+        {
+            linkAfter(tail, pool.get());
+        }
+        new(&tail->items()[tail->count++]) T(v);
+        len++;
+    }
+
+    void push_front(const T& v)
+    {
+        if(head == NULL || head->count == NodeCap)
+        {
+            linkAfter(NULL, pool.get());
+        }
+        T* a = head->items();
+        shiftRight(a, 0, head->count);
+        new(&a[0]) T(v);
+        head->count++;
+        len++;
+    }
+
+    void pop_back()
+    {
+        erase(--end());
+    }
+
+    void pop_front()
+    {
+        erase(begin());
+    }
+
+    //在pos前插入, 节点满了就对半分裂
+    iterator insert(iterator pos, const T& v)
+    {
+        if(pos.nd == NULL)
+        {
+            push_back(v);
+            return --end();
+        }
+        node* n = pos.nd;
+        int i = pos.idx;
+        if(n->count == NodeCap)
+        {
+            node* right = pool.get();
+            int half = NodeCap / 2;
+            moveRange(n->items() + half, NodeCap - half, right->items());
+            right->count = NodeCap - half;
+            n->count = half;
+            linkAfter(n, right);
+            if(i >= half)
+            {
+                n = right;
+                i -= half;
+            }
+        }
+        T* a = n->items();
+        shiftRight(a, i, n->count);
+        new(&a[i]) T(v);
+        n->count++;
+        len++;
+        return iterator(this, n, i);
+    }
+
+    //返回被删元素后面的位置; 节点太空时把下一个节点并进来
+    iterator erase(iterator pos)
+    {
+        node* n = pos.nd;
+        int i = pos.idx;
+        T* a = n->items();
+        a[i].~T();
+        for(int k = i; k + 1 < n->count; k++)
+        {
+            new(&a[k]) T(std::move(a[k + 1]));
+            a[k + 1].~T();
+        }
+        n->count--;
+        len--;
+
+        if(n->count == 0)
+        {
+            node* next = n->next;
+            unlink(n);
+            pool.put(n);
+            return iterator(this, next, 0);
+        }
+        node* next = n->next;
+        if(next != NULL && n->count < NodeCap / 4 && n->count + next->count <= NodeCap)
+        {
+            moveRange(next->items(), next->count, a + n->count);
+            n->count += next->count;
+            next->count = 0;
+            unlink(next);
+            pool.put(next);
+        }
+        if(i == n->count)
+        {
+            return iterator(this, n->next, 0);
+        }
+        return iterator(this, n, i);
+    }
+
+    void clear()
+    {
+        node* n = head;
+        while(n != NULL)
+        {
+            node* next = n->next;
+            for(int i = 0; i<n->count; i++)
+            {
+                n->items()[i].~T();
+            }
+            pool.put(n);
+            n = next;
+        }
+        head = tail = NULL;
+        len = 0;
+    }
+
+    //把other整个接到pos前面, other变空
+    //pos在节点中间时先在pos处把节点切开, 只移动这一个节点里的元素
+    void splice(iterator pos, unrolledList& other)
+    {
+        if(&other == this || other.head == NULL)
+        {
+            return;
+        }
+        node* before;
+        if(pos.nd == NULL)
+        {
+            before = tail;
+        }
+        else if(pos.idx == 0)
+        {
+            before = pos.nd->prev;
+        }
+        else
+        {
+            node* n = pos.nd;
+            node* right = pool.get();
+            moveRange(n->items() + pos.idx, n->count - pos.idx, right->items());
+            right->count = n->count - pos.idx;
+            n->count = pos.idx;
+            linkAfter(n, right);
+            before = n;
+        }
+
+        node* first = other.head;
+        node* last = other.tail;
+        node* after = before != NULL ? before->next : head;
+        first->prev = before;
+        last->next = after;
+        if(before != NULL)
+        {
+            before->next = first;
+        }
+        else
+        {
+            head = first;
+        }
+        if(after != NULL)
+        {
+            after->prev = last;
+        }
+        else
+        {
+            tail = last;
+        }
+        len += other.len;
+        pool.absorb(other.pool);
+        other.head = other.tail = NULL;
+        other.len = 0;
+    }
+
+private:
+    static void shiftRight(T* a, int from, int count)
+    {
+        for(int k = count; k > from; k--)
+        {
+            new(&a[k]) T(std::move(a[k - 1]));
+            a[k - 1].~T();
+        }
+    }
+
+    static void moveRange(T* src, int n, T* dst)
+    {
+        for(int k = 0; k<n; k++)
+        {
+            new(&dst[k]) T(std::move(src[k]));
+            src[k].~T();
+        }
+    }
+
+    //before为NULL时放到最前面
+    void linkAfter(node* before, node* n)
+    {
+        node* after = before != NULL ? before->next : head;
+        n->prev = before;
+        n->next = after;
+        if(before != NULL)
+        {
+            before->next = n;
+        }
+        else
+        {
+            head = n;
+        }
+        if(after != NULL)
+        {
+            after->prev = n;
+        }
+        else
+        {
+            tail = n;
+        }
+    }
+
+    void unlink(node* n)
+    {
+        if(n->prev != NULL)
+        {
+            n->prev->next = n->next;
+        }
+        else
+        {
+            head = n->next;
+        }
+        if(n->next != NULL)
+        {
+            n->next->prev = n->prev;
+        }
+        else
+        {
+            tail = n->prev;
+        }
+    }
+
+    node* head;
+    node* tail;
+    size_t len;
+    nodePool pool;
+};
+
+typedef unrolledList<int> LISTINT;
+typedef unrolledList<char> LISTHAR;
+
+void test01()
+{
+    LISTINT listone;
+    listone.push_front(2);
+    listone.push_front(1);
+    listone.push_back(3);
+    listone.push_back(4);
+
+    cout<<"listone.begin()~~~~~~~~~listone.end():"<<endl;
+    for(LISTINT::iterator i = listone.begin(); i != listone.end(); i++)
+    {
+        cout<<*i<<" ";
+    }
+    cout<<endl;
+
+    cout<<"listone.rbegin()~~~~~~~~~~~~listone.rend()"<<endl;
+    for(LISTINT::reverse_iterator ir = listone.rbegin(); ir != listone.rend(); ir++)
+    {
+        cout<<*ir<<" ";
+    }
+    cout<<endl;
+
+    int result = accumulate(listone.begin(), listone.end(), 10);//10为累加的初始值
+    cout<<"sum="<<result<<endl;
+    cout<<"---------------------"<<endl;
+
+    LISTHAR listtwo;
+    listtwo.push_front('a');
+    listtwo.push_front('b');
+    listtwo.push_back('c');
+    listtwo.push_back('d');
+    LISTHAR::iterator j = max_element(listtwo.begin(), listtwo.end());
+    cout<<"The maximum element in listtwo is:"<<char(*j)<<endl;
+}
+
+void test02()
+{
+    //和std::list对照: 插入, 删除, splice
+    unrolledList<int, 4> u;
+    list<int> l;
+    for(int i = 0; i<20; i++)
+    {
+        u.push_back(i);
+        l.push_back(i);
+    }
+    unrolledList<int, 4>::iterator ui = u.begin();
+    list<int>::iterator li = l.begin();
+    for(int k = 0; k<7; k++)
+    {
+        ++ui;
+        ++li;
+    }
+    for(int k = 0; k<5; k++)
+    {
+        ui = u.insert(ui, 100 + k);
+        li = l.insert(li, 100 + k);
+    }
+    for(int k = 0; k<6; k++)
+    {
+        ui = u.erase(ui);
+        li = l.erase(li);
+    }
+
+    unrolledList<int, 4> other;
+    list<int> lother;
+    for(int i = 0; i<9; i++)
+    {
+        other.push_back(-i);
+        lother.push_back(-i);
+    }
+    u.splice(ui, other);
+    l.splice(li, lother);
+    u.pop_front();
+    l.pop_front();
+    u.pop_back();
+    l.pop_back();
+
+    for(unrolledList<int, 4>::iterator it = u.begin(); it != u.end(); ++it)
+    {
+        cout<<*it<<" ";
+    }
+    cout<<endl;
+    cout<<"same as std::list: "<<(u.size() == l.size() && equal(u.begin(), u.end(), l.begin()) ? "yes" : "NO")
+        <<", other empty: "<<other.empty()<<endl;
+}
+
+void test03()
+{
+    const int n = 10000000;
+
+    auto t0 = chrono::steady_clock::now();
+    list<int> l;
+    for(int i = 0; i<n; i++)
+    {
+        l.push_back(i % 1000);
+    }
+    auto t1 = chrono::steady_clock::now();
+    LISTINT u;
+    for(int i = 0; i<n; i++)
+    {
+        u.push_back(i % 1000);
+    }
+    auto t2 = chrono::steady_clock::now();
+    long long s1 = accumulate(l.begin(), l.end(), 0LL);
+    int m1 = *max_element(l.begin(), l.end());
+    auto t3 = chrono::steady_clock::now();
+    long long s2 = accumulate(u.begin(), u.end(), 0LL);
+    int m2 = *max_element(u.begin(), u.end());
+    auto t4 = chrono::steady_clock::now();
+
+    cout<<"push_back  list "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms, unrolled "
+        <<chrono::duration<double, milli>(t2 - t1).count()<<" ms"<<endl;
+    cout<<"sum + max  list "<<chrono::duration<double, milli>(t3 - t2).count()<<" ms, unrolled "
+        <<chrono::duration<double, milli>(t4 - t3).count()<<" ms ("
+        <<(s1 == s2 && m1 == m2 ? "same" : "DIFFERENT")<<")"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+    test03();
+
+    system("pause");
+}
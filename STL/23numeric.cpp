@@ -0,0 +1,926 @@
+#include<iostream>
+#include<vector>
+#include<numeric>
+#include<algorithm>
+#include<thread>
+#include<chrono>
+#include<cmath>
+#include<limits>
+#include<type_traits>
+#include<cstdint>
+#include<cstddef>
+#if defined(__x86_64__) || defined(__i386__)
+#include<immintrin.h>
+#define REDUCE_X86 1
+#endif
+using namespace std;
+
+//连续内存上的归约: sum(可选Kahan/两两求和), min, max, argmin/argmax, dot, count_if
+//标量版本用4个累加器打断循环依赖; double, float, int32_t还有AVX2版本, 第一次调用时检查CPU选用哪个
+//count_if的谓词是任意函数, 其他元素类型也没有专门的版本, 这两种只用标量代码
+//浮点数里有NaN时: min/max返回NaN, argmin/argmax返回第一个NaN的位置
+//数据量大时用parallelReduce切块多线程算, 再把各块结果合起来
+
+//----------------标量版本----------------
+
+template<class T>
+T sumScalar(const T* p, size_t n)
+{
+    T s0 = T(), s1 = T(), s2 = T(), s3 = T();
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        s0 += p[i];
+        s1 += p[i + 1];
+        s2 += p[i + 2];
+        s3 += p[i + 3];
+    }
+    for(; i<n; i++)
+    {
+        s0 += p[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+template<class T>
+T dotScalar(const T* a, const T* b, size_t n)
+{
+    T s0 = T(), s1 = T(), s2 = T(), s3 = T();
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for(; i<n; i++)
+    {
+        s0 += a[i] * b[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+//n必须大于0; 浮点数里只要有NaN就返回NaN(和比较的先后顺序无关)
+template<class T>
+T minScalar(const T* p, size_t n)
+{
+    T m0 = p[0], m1 = p[0], m2 = p[0], m3 = p[0];
+    bool nan = false;
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        m0 = p[i] < m0 ? p[i] : m0;
+        m1 = p[i + 1] < m1 ? p[i + 1] : m1;
+        m2 = p[i + 2] < m2 ? p[i + 2] : m2;
+        m3 = p[i + 3] < m3 ? p[i + 3] : m3;
+        if constexpr(is_floating_point<T>::value)
+        {
+            nan = nan | (p[i] != p[i]) | (p[i + 1] != p[i + 1]) | (p[i + 2] != p[i + 2]) | (p[i + 3] != p[i + 3]);
+        }
+    }
+    for(; i<n; i++)
+    {
+        m0 = p[i] < m0 ? p[i] : m0;
+        if constexpr(is_floating_point<T>::value)
+        {
+            nan = nan | (p[i] != p[i]);
+        }
+    }
+    if constexpr(is_floating_point<T>::value)
+    {
+        if(nan || p[0] != p[0])
+        {
+            return numeric_limits<T>::quiet_NaN();
+        }
+    }
+    return min(min(m0, m1), min(m2, m3));
+}
+
+template<class T>
+T maxScalar(const T* p, size_t n)
+{
+    T m0 = p[0], m1 = p[0], m2 = p[0], m3 = p[0];
+    bool nan = false;
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        m0 = p[i] > m0 ? p[i] : m0;
+        m1 = p[i + 1] > m1 ? p[i + 1] : m1;
+        m2 = p[i + 2] > m2 ? p[i + 2] : m2;
+        m3 = p[i + 3] > m3 ? p[i + 3] : m3;
+        if constexpr(is_floating_point<T>::value)
+        {
+            nan = nan | (p[i] != p[i]) | (p[i + 1] != p[i + 1]) | (p[i + 2] != p[i + 2]) | (p[i + 3] != p[i + 3]);
+        }
+    }
+    for(; i<n; i++)
+    {
+        m0 = p[i] > m0 ? p[i] : m0;
+        if constexpr(is_floating_point<T>::value)
+        {
+            nan = nan | (p[i] != p[i]);
+        }
+    }
+    if constexpr(is_floating_point<T>::value)
+    {
+        if(nan || p[0] != p[0])
+        {
+            return numeric_limits<T>::quiet_NaN();
+        }
+    }
+    return max(max(m0, m1), max(m2, m3));
+}
+
+//Kahan补偿求和: 记下每次加法丢掉的低位, 下次补回来
+template<class T>
+T kahanScalar(const T* p, size_t n)
+{
+    T sum = T();
+    T c = T();
+    for(size_t i = 0; i<n; i++)
+    {
+        T y = p[i] - c;
+        T t = sum + y;
+        c = (t - sum) - y;
+        sum = t;
+    }
+    return sum;
+}
+
+//第一个等于v的位置, 没有就返回n
+template<class T>
+size_t findScalar(const T* p, size_t n, T v)
+{
+    return find(p, p + n, v) - p;
+}
+
+//----------------AVX2版本(double, float, int32)----------------
+//每种类型一组: sum, dot(浮点要FMA), min/max, Kahan, find
+//min/max另外用一个寄存器记下有没有NaN, 有的话返回NaN, 和标量版本一致
+
+#ifdef REDUCE_X86
+__attribute__((target("avx2")))
+static double hsum256(__m256d v)
+{
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(lo) + _mm_cvtsd_f64(_mm_unpackhi_pd(lo, lo));
+}
+
+__attribute__((target("avx2")))
+static float hsum256(__m256 v)
+{
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1));
+    return _mm_cvtss_f32(lo);
+}
+
+__attribute__((target("avx2")))
+static int32_t hsum256(__m256i v)
+{
+    __m128i lo = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0x4E));
+    lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0xB1));
+    return _mm_cvtsi128_si32(lo);
+}
+
+__attribute__((target("avx2")))
+static double sumAvx2(const double* p, size_t n)
+{
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        s0 = _mm256_add_pd(s0, _mm256_loadu_pd(p + i));
+        s1 = _mm256_add_pd(s1, _mm256_loadu_pd(p + i + 4));
+        s2 = _mm256_add_pd(s2, _mm256_loadu_pd(p + i + 8));
+        s3 = _mm256_add_pd(s3, _mm256_loadu_pd(p + i + 12));
+    }
+    double s = hsum256(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+    for(; i<n; i++)
+    {
+        s += p[i];
+    }
+    return s;
+}
+
+__attribute__((target("avx2")))
+static float sumAvx2(const float* p, size_t n)
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+        s0 = _mm256_add_ps(s0, _mm256_loadu_ps(p + i));
+        s1 = _mm256_add_ps(s1, _mm256_loadu_ps(p + i + 8));
+        s2 = _mm256_add_ps(s2, _mm256_loadu_ps(p + i + 16));
+        s3 = _mm256_add_ps(s3, _mm256_loadu_ps(p + i + 24));
+    }
+    float s = hsum256(_mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)));
+    for(; i<n; i++)
+    {
+        s += p[i];
+    }
+    return s;
+}
+
+//整数加法溢出时按补码回绕
+__attribute__((target("avx2")))
+static int32_t sumAvx2(const int32_t* p, size_t n)
+{
+    __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        s0 = _mm256_add_epi32(s0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+        s1 = _mm256_add_epi32(s1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 8)));
+    }
+    uint32_t s = uint32_t(hsum256(_mm256_add_epi32(s0, s1)));
+    for(; i<n; i++)
+    {
+        s += uint32_t(p[i]);
+    }
+    return int32_t(s);
+}
+
+__attribute__((target("avx2,fma")))
+static double dotAvx2(const double* a, const double* b, size_t n)
+{
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), s1);
+        s2 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8), s2);
+        s3 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12), s3);
+    }
+    double s = hsum256(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+    for(; i<n; i++)
+    {
+        s += a[i] * b[i];
+    }
+    return s;
+}
+
+__attribute__((target("avx2,fma")))
+static float dotAvx2(const float* a, const float* b, size_t n)
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), s1);
+        s2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), s2);
+        s3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), s3);
+    }
+    float s = hsum256(_mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)));
+    for(; i<n; i++)
+    {
+        s += a[i] * b[i];
+    }
+    return s;
+}
+
+__attribute__((target("avx2")))
+static int32_t dotAvx2(const int32_t* a, const int32_t* b, size_t n)
+{
+    __m256i s0 = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        s0 = _mm256_add_epi32(s0, _mm256_mullo_epi32(x, y));
+    }
+    uint32_t s = uint32_t(hsum256(s0));
+    for(; i<n; i++)
+    {
+        s += uint32_t(a[i]) * uint32_t(b[i]);
+    }
+    return int32_t(s);
+}
+
+__attribute__((target("avx2")))
+static double minAvx2(const double* p, size_t n)
+{
+    if(n < 8)
+    {
+        return minScalar(p, n);
+    }
+    __m256d m0 = _mm256_loadu_pd(p), m1 = m0;
+    __m256d nan = _mm256_setzero_pd();
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256d x0 = _mm256_loadu_pd(p + i), x1 = _mm256_loadu_pd(p + i + 4);
+        m0 = _mm256_min_pd(m0, x0);
+        m1 = _mm256_min_pd(m1, x1);
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(x0, x1, _CMP_UNORD_Q));
+    }
+    double tmp[4];
+    _mm256_storeu_pd(tmp, _mm256_min_pd(m0, m1));
+    double m = min(min(tmp[0], tmp[1]), min(tmp[2], tmp[3]));
+    bool hasNan = _mm256_movemask_pd(nan) != 0;
+    for(; i<n; i++)
+    {
+        m = p[i] < m ? p[i] : m;
+        hasNan = hasNan || p[i] != p[i];
+    }
+    return hasNan ? numeric_limits<double>::quiet_NaN() : m;
+}
+
+__attribute__((target("avx2")))
+static double maxAvx2(const double* p, size_t n)
+{
+    if(n < 8)
+    {
+        return maxScalar(p, n);
+    }
+    __m256d m0 = _mm256_loadu_pd(p), m1 = m0;
+    __m256d nan = _mm256_setzero_pd();
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256d x0 = _mm256_loadu_pd(p + i), x1 = _mm256_loadu_pd(p + i + 4);
+        m0 = _mm256_max_pd(m0, x0);
+        m1 = _mm256_max_pd(m1, x1);
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(x0, x1, _CMP_UNORD_Q));
+    }
+    double tmp[4];
+    _mm256_storeu_pd(tmp, _mm256_max_pd(m0, m1));
+    double m = max(max(tmp[0], tmp[1]), max(tmp[2], tmp[3]));
+    bool hasNan = _mm256_movemask_pd(nan) != 0;
+    for(; i<n; i++)
+    {
+        m = p[i] > m ? p[i] : m;
+        hasNan = hasNan || p[i] != p[i];
+    }
+    return hasNan ? numeric_limits<double>::quiet_NaN() : m;
+}
+
+__attribute__((target("avx2")))
+static float minAvx2(const float* p, size_t n)
+{
+    if(n < 16)
+    {
+        return minScalar(p, n);
+    }
+    __m256 m0 = _mm256_loadu_ps(p), m1 = m0;
+    __m256 nan = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m256 x0 = _mm256_loadu_ps(p + i), x1 = _mm256_loadu_ps(p + i + 8);
+        m0 = _mm256_min_ps(m0, x0);
+        m1 = _mm256_min_ps(m1, x1);
+        nan = _mm256_or_ps(nan, _mm256_cmp_ps(x0, x1, _CMP_UNORD_Q));
+    }
+    float tmp[8];
+    _mm256_storeu_ps(tmp, _mm256_min_ps(m0, m1));
+    float m = minScalar(tmp, 8);
+    bool hasNan = _mm256_movemask_ps(nan) != 0;
+    for(; i<n; i++)
+    {
+        m = p[i] < m ? p[i] : m;
+        hasNan = hasNan || p[i] != p[i];
+    }
+    return hasNan ? numeric_limits<float>::quiet_NaN() : m;
+}
+
+__attribute__((target("avx2")))
+static float maxAvx2(const float* p, size_t n)
+{
+    if(n < 16)
+    {
+        return maxScalar(p, n);
+    }
+    __m256 m0 = _mm256_loadu_ps(p), m1 = m0;
+    __m256 nan = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m256 x0 = _mm256_loadu_ps(p + i), x1 = _mm256_loadu_ps(p + i + 8);
+        m0 = _mm256_max_ps(m0, x0);
+        m1 = _mm256_max_ps(m1, x1);
+        nan = _mm256_or_ps(nan, _mm256_cmp_ps(x0, x1, _CMP_UNORD_Q));
+    }
+    float tmp[8];
+    _mm256_storeu_ps(tmp, _mm256_max_ps(m0, m1));
+    float m = maxScalar(tmp, 8);
+    bool hasNan = _mm256_movemask_ps(nan) != 0;
+    for(; i<n; i++)
+    {
+        m = p[i] > m ? p[i] : m;
+        hasNan = hasNan || p[i] != p[i];
+    }
+    return hasNan ? numeric_limits<float>::quiet_NaN() : m;
+}
+
+__attribute__((target("avx2")))
+static int32_t minAvx2(const int32_t* p, size_t n)
+{
+    if(n < 8)
+    {
+        return minScalar(p, n);
+    }
+    __m256i m0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        m0 = _mm256_min_epi32(m0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+    }
+    int32_t tmp[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(tmp), m0);
+    int32_t m = minScalar(tmp, 8);
+    for(; i<n; i++)
+    {
+        m = p[i] < m ? p[i] : m;
+    }
+    return m;
+}
+
+__attribute__((target("avx2")))
+static int32_t maxAvx2(const int32_t* p, size_t n)
+{
+    if(n < 8)
+    {
+        return maxScalar(p, n);
+    }
+    __m256i m0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        m0 = _mm256_max_epi32(m0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+    }
+    int32_t tmp[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(tmp), m0);
+    int32_t m = maxScalar(tmp, 8);
+    for(; i<n; i++)
+    {
+        m = p[i] > m ? p[i] : m;
+    }
+    return m;
+}
+
+//每条通道各自做Kahan求和, 最后把各通道的和与补偿量再用标量Kahan合起来
+__attribute__((target("avx2")))
+static double kahanAvx2(const double* p, size_t n)
+{
+    __m256d sum = _mm256_setzero_pd(), c = _mm256_setzero_pd();
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d y = _mm256_sub_pd(_mm256_loadu_pd(p + i), c);
+        __m256d t = _mm256_add_pd(sum, y);
+        c = _mm256_sub_pd(_mm256_sub_pd(t, sum), y);
+        sum = t;
+    }
+    double parts[8];
+    _mm256_storeu_pd(parts, sum);
+    _mm256_storeu_pd(parts + 4, _mm256_sub_pd(_mm256_setzero_pd(), c));
+    double s = 0, cs = 0;
+    for(int k = 0; k<8; k++)
+    {
+        double y = parts[k] - cs;
+        double t = s + y;
+        cs = (t - s) - y;
+        s = t;
+    }
+    for(; i<n; i++)
+    {
+        double y = p[i] - cs;
+        double t = s + y;
+        cs = (t - s) - y;
+        s = t;
+    }
+    return s;
+}
+
+__attribute__((target("avx2")))
+static float kahanAvx2(const float* p, size_t n)
+{
+    __m256 sum = _mm256_setzero_ps(), c = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256 y = _mm256_sub_ps(_mm256_loadu_ps(p + i), c);
+        __m256 t = _mm256_add_ps(sum, y);
+        c = _mm256_sub_ps(_mm256_sub_ps(t, sum), y);
+        sum = t;
+    }
+    float parts[16];
+    _mm256_storeu_ps(parts, sum);
+    _mm256_storeu_ps(parts + 8, _mm256_sub_ps(_mm256_setzero_ps(), c));
+    float s = 0, cs = 0;
+    for(int k = 0; k<16; k++)
+    {
+        float y = parts[k] - cs;
+        float t = s + y;
+        cs = (t - s) - y;
+        s = t;
+    }
+    for(; i<n; i++)
+    {
+        float y = p[i] - cs;
+        float t = s + y;
+        cs = (t - s) - y;
+        s = t;
+    }
+    return s;
+}
+
+__attribute__((target("avx2")))
+static size_t findAvx2(const double* p, size_t n, double v)
+{
+    __m256d x = _mm256_set1_pd(v);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        int m = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p + i), x, _CMP_EQ_OQ));
+        if(m != 0)
+        {
+            return i + __builtin_ctz(m);
+        }
+    }
+    return i + findScalar(p + i, n - i, v);
+}
+
+__attribute__((target("avx2")))
+static size_t findAvx2(const float* p, size_t n, float v)
+{
+    __m256 x = _mm256_set1_ps(v);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        int m = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p + i), x, _CMP_EQ_OQ));
+        if(m != 0)
+        {
+            return i + __builtin_ctz(m);
+        }
+    }
+    return i + findScalar(p + i, n - i, v);
+}
+
+__attribute__((target("avx2")))
+static size_t findAvx2(const int32_t* p, size_t n, int32_t v)
+{
+    __m256i x = _mm256_set1_epi32(v);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256i e = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), x);
+        int m = _mm256_movemask_ps(_mm256_castsi256_ps(e));
+        if(m != 0)
+        {
+            return i + __builtin_ctz(m);
+        }
+    }
+    return i + findScalar(p + i, n - i, v);
+}
+#endif
+
+//----------------运行时选择----------------
+
+template<class T>
+struct reduceKernels
+{
+    T (*sum)(const T*, size_t);
+    T (*dot)(const T*, const T*, size_t);
+    T (*min)(const T*, size_t);
+    T (*max)(const T*, size_t);
+    T (*kahan)(const T*, size_t);
+    size_t (*find)(const T*, size_t, T);
+    const char* name;
+};
+
+//T是double, float或int32_t
+template<class T>
+static reduceKernels<T> pickKernels()
+{
+    reduceKernels<T> k = { sumScalar<T>, dotScalar<T>, minScalar<T>, maxScalar<T>, kahanScalar<T>, findScalar<T>, "scalar" };
+#ifdef REDUCE_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        k.sum = sumAvx2;
+        k.min = minAvx2;
+        k.max = maxAvx2;
+        k.find = findAvx2;
+        k.name = "avx2";
+        //整数乘法不需要FMA
+        if constexpr(is_integral<T>::value)
+        {
+            k.dot = dotAvx2;
+        }
+        else
+        {
+            k.kahan = kahanAvx2;
+            if(__builtin_cpu_supports("fma"))
+            {
+                k.dot = dotAvx2;
+                k.name = "avx2+fma";
+            }
+        }
+    }
+#endif
+    //整数没有舍入误差, Kahan就是普通求和
+    if constexpr(is_integral<T>::value)
+    {
+        k.kahan = k.sum;
+    }
+    return k;
+}
+
+template<class T>
+static const reduceKernels<T>& kernels()
+{
+    static reduceKernels<T> k = pickKernels<T>();
+    return k;
+}
+
+//----------------对外接口----------------
+//double, float, int32_t走上面选好的函数, 其他类型(char, long long...)用标量模板
+
+template<class T>
+struct hasKernels
+{
+    static const bool value = is_same<T, double>::value || is_same<T, float>::value || is_same<T, int32_t>::value;
+};
+
+template<class T>
+T reduceSum(const T* p, size_t n)
+{
+    if constexpr(hasKernels<T>::value)
+    {
+        return kernels<T>().sum(p, n);
+    }
+    return sumScalar(p, n);
+}
+
+template<class T>
+T reduceDot(const T* a, const T* b, size_t n)
+{
+    if constexpr(hasKernels<T>::value)
+    {
+        return kernels<T>().dot(a, b, n);
+    }
+    return dotScalar(a, b, n);
+}
+
+//n必须大于0; 有NaN时返回NaN
+template<class T>
+T reduceMin(const T* p, size_t n)
+{
+    if constexpr(hasKernels<T>::value)
+    {
+        return kernels<T>().min(p, n);
+    }
+    return minScalar(p, n);
+}
+
+template<class T>
+T reduceMax(const T* p, size_t n)
+{
+    if constexpr(hasKernels<T>::value)
+    {
+        return kernels<T>().max(p, n);
+    }
+    return maxScalar(p, n);
+}
+
+template<class T>
+T reduceSumKahan(const T* p, size_t n)
+{
+    if constexpr(hasKernels<T>::value)
+    {
+        return kernels<T>().kahan(p, n);
+    }
+    return kahanScalar(p, n);
+}
+
+template<class T>
+size_t reduceFind(const T* p, size_t n, T v)
+{
+    if constexpr(hasKernels<T>::value)
+    {
+        return kernels<T>().find(p, n, v);
+    }
+    return findScalar(p, n, v);
+}
+
+//先求出最值, 再找第一个等于它的位置; 两遍都是顺序读
+//有NaN时最值是NaN, 和谁都不相等, 这时返回第一个NaN的位置(和numpy.argmax一样), 结果总是小于n
+template<class T>
+size_t firstNaN(const T* p, size_t n)
+{
+    return find_if(p, p + n, [](T x) { return x != x; }) - p;
+}
+
+template<class T>
+size_t reduceArgmin(const T* p, size_t n)
+{
+    T m = reduceMin(p, n);
+    if(m != m)
+    {
+        return firstNaN(p, n);
+    }
+    return reduceFind(p, n, m);
+}
+
+template<class T>
+size_t reduceArgmax(const T* p, size_t n)
+{
+    T m = reduceMax(p, n);
+    if(m != m)
+    {
+        return firstNaN(p, n);
+    }
+    return reduceFind(p, n, m);
+}
+
+//谓词结果直接累加, 循环里没有分支
+//谓词是任意的函数对象, 没法事先写好SIMD版本, 只能交给编译器自动向量化
+template<class T, class Pred>
+size_t reduceCountIf(const T* p, size_t n, Pred pred)
+{
+    size_t c0 = 0, c1 = 0;
+    size_t i = 0;
+    for(; i + 2 <= n; i += 2)
+    {
+        c0 += pred(p[i]) ? 1 : 0;
+        c1 += pred(p[i + 1]) ? 1 : 0;
+    }
+    for(; i<n; i++)
+    {
+        c0 += pred(p[i]) ? 1 : 0;
+    }
+    return c0 + c1;
+}
+
+//两两求和: 误差随log(n)增长, 小块直接用快速求和
+template<class T>
+T reduceSumPairwise(const T* p, size_t n)
+{
+    if(n <= 256)
+    {
+        return reduceSum(p, n);
+    }
+    size_t half = n / 2;
+    return reduceSumPairwise(p, half) + reduceSumPairwise(p + half, n - half);
+}
+
+//切成若干块, 每个线程算一块, 再用combine合起来; 数据少时直接单线程
+template<class R, class Fn, class Combine>
+R parallelReduce(size_t n, Fn chunk, Combine combine, size_t minPerThread = 1 << 16)
+{
+    size_t threads = thread::hardware_concurrency();
+    threads = min<size_t>(threads == 0 ? 1 : threads, max<size_t>(1, n / minPerThread));
+    if(threads <= 1)
+    {
+        return chunk(size_t(0), n);
+    }
+    vector<R> parts(threads);
+    vector<thread> ws;
+    size_t step = (n + threads - 1) / threads;
+    for(size_t t = 0; t<threads; t++)
+    {
+        size_t begin = min(n, t * step);
+        size_t end = min(n, begin + step);
+        ws.push_back(thread([&parts, &chunk, t, begin, end]() { parts[t] = chunk(begin, end); }));
+    }
+    for(size_t t = 0; t<ws.size(); t++)
+    {
+        ws[t].join();
+    }
+    R r = parts[0];
+    for(size_t t = 1; t<threads; t++)
+    {
+        r = combine(r, parts[t]);
+    }
+    return r;
+}
+
+template<class T>
+T parallelSum(const T* p, size_t n)
+{
+    return parallelReduce<T>(n, [p](size_t b, size_t e) { return reduceSum(p + b, e - b); },
+                             [](T a, T b) { return a + b; });
+}
+
+template<class T>
+T parallelDot(const T* a, const T* b, size_t n)
+{
+    return parallelReduce<T>(n, [a, b](size_t s, size_t e) { return reduceDot(a + s, b + s, e - s); },
+                             [](T x, T y) { return x + y; });
+}
+
+template<class T>
+size_t parallelArgmax(const T* p, size_t n)
+{
+    return parallelReduce<size_t>(n, [p](size_t b, size_t e) { return b + reduceArgmax(p + b, e - b); },
+                                  [p](size_t x, size_t y)
+    {
+        //前面一块是NaN就保留它, 后面一块是NaN或者更大就换成后面的
+        if(p[x] != p[x])
+        {
+            return x;
+        }
+        return p[y] != p[y] || p[y] > p[x] ? y : x;
+    });
+}
+
+void test01()
+{
+    //对应12list里的accumulate和max_element
+    int listone[] = {1, 2, 3, 4};
+    cout<<"sum="<<reduceSum(listone, 4) + 10<<endl;
+    char listtwo[] = {'b', 'a', 'c', 'd'};
+    cout<<"The maximum element in listtwo is:"<<listtwo[reduceArgmax(listtwo, 4)]<<endl;
+
+    //对应01enum里的double数组
+    double arr[10] = {10, 12, 5, 8, 65, 9};
+    cout<<"kernels: double "<<kernels<double>().name<<", float "<<kernels<float>().name<<", int "<<kernels<int32_t>().name<<endl;
+    cout<<"sum "<<reduceSum(arr, 10)<<", min "<<reduceMin(arr, 10)<<", max "<<reduceMax(arr, 10)
+        <<", argmax "<<reduceArgmax(arr, 10)<<", argmin "<<reduceArgmin(arr, 10)
+        <<", dot "<<reduceDot(arr, arr, 10)
+        <<", count>8 "<<reduceCountIf(arr, 10, [](double x) { return x > 8; })<<endl;
+
+    //精度: 1e16加很多个1
+    vector<double> v(1000001, 1.0);
+    v[0] = 1e16;
+    cout.precision(17);
+    cout<<"plain "<<reduceSum(v.data(), v.size())<<", kahan "<<reduceSumKahan(v.data(), v.size())
+        <<", pairwise "<<reduceSumPairwise(v.data(), v.size())<<", exact 10000000001000000"<<endl;
+
+    vector<float> f(1000001, 1.0f);
+    f[0] = 1e8f;
+    cout<<"float plain "<<reduceSum(f.data(), f.size())<<", kahan "<<reduceSumKahan(f.data(), f.size())<<", exact 101000000"<<endl;
+    cout.precision(6);
+
+    //NaN: argmax/argmin返回第一个NaN的位置, 不会返回n
+    double withNan[20];
+    for(int i = 0; i<20; i++)
+    {
+        withNan[i] = i;
+    }
+    withNan[13] = numeric_limits<double>::quiet_NaN();
+    withNan[17] = numeric_limits<double>::quiet_NaN();
+    cout<<"with NaN: max "<<reduceMax(withNan, 20)<<", argmax "<<reduceArgmax(withNan, 20)
+        <<", argmin "<<reduceArgmin(withNan, 20)<<", parallel argmax "<<parallelArgmax(withNan, 20)<<endl;
+
+    int ints[20];
+    for(int i = 0; i<20; i++)
+    {
+        ints[i] = (i * 7) % 20 - 5;
+    }
+    cout<<"int: sum "<<reduceSum(ints, 20)<<", dot "<<reduceDot(ints, ints, 20)<<", min "<<reduceMin(ints, 20)
+        <<" at "<<reduceArgmin(ints, 20)<<", max "<<reduceMax(ints, 20)<<" at "<<reduceArgmax(ints, 20)<<endl;
+}
+
+void test02()
+{
+    const size_t n = 50000000;
+    vector<double> a(n);
+    vector<double> b(n);
+    for(size_t i = 0; i<n; i++)
+    {
+        a[i] = double(i % 1000) * 0.5;
+        b[i] = double((i * 7) % 13);
+    }
+    a[n / 3] = 1e9;
+
+    auto t0 = chrono::steady_clock::now();
+    double s1 = accumulate(a.begin(), a.end(), 0.0);
+    size_t m1 = max_element(a.begin(), a.end()) - a.begin();
+    double d1 = inner_product(a.begin(), a.end(), b.begin(), 0.0);
+    auto t1 = chrono::steady_clock::now();
+    double s2 = reduceSum(a.data(), n);
+    size_t m2 = reduceArgmax(a.data(), n);
+    double d2 = reduceDot(a.data(), b.data(), n);
+    auto t2 = chrono::steady_clock::now();
+    double s3 = parallelSum(a.data(), n);
+    size_t m3 = parallelArgmax(a.data(), n);
+    double d3 = parallelDot(a.data(), b.data(), n);
+    auto t3 = chrono::steady_clock::now();
+
+    cout<<"std      "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms: "<<s1<<" "<<m1<<" "<<d1<<endl;
+    cout<<"reduce   "<<chrono::duration<double, milli>(t2 - t1).count()<<" ms: "<<s2<<" "<<m2<<" "<<d2<<endl;
+    cout<<"parallel "<<chrono::duration<double, milli>(t3 - t2).count()<<" ms: "<<s3<<" "<<m3<<" "<<d3<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+
+    system("pause");
+}
@@ -0,0 +1,567 @@
+#include<iostream>
+#include<string>
+#include<string_view>
+#include<map>
+#include<unordered_map>
+#include<vector>
+#include<utility>
+#include<functional>
+#include<chrono>
+#include<new>
+#include<cstdint>
+#include<cstring>
+#include<stdexcept>
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
+using namespace std;
+
+//开放寻址哈希表(Swiss table)
+//每个槽位对应一个控制字节: 空/已删除/或者哈希值的低7位(h2)
+//控制字节16个一组, 查找时一条SSE2指令把一组里等于h2的位置全部找出来, 再逐个比较key
+//哈希值的其余位(h1)决定从哪一组开始探测, 组内有空位就说明key不存在
+//哈希函数带is_transparent时可以直接用string_view查找, 不用先构造string
+
+static const int8_t CTRL_EMPTY = -128;
+static const int8_t CTRL_DELETED = -2;
+static const size_t GROUP = 16;
+
+//一组控制字节的匹配结果, 第i位为1表示第i个槽位匹配
+struct groupMask
+{
+    uint32_t bits;
+
+    explicit groupMask(uint32_t b) : bits(b) {}
+    bool any() const { return bits != 0; }
+    int lowest() const { return __builtin_ctz(bits); }
+    void clearLowest() { bits &= bits - 1; }
+};
+
+struct ctrlGroup
+{
+#ifdef __SSE2__
+    __m128i v;
+    explicit ctrlGroup(const int8_t* p) : v(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+    groupMask match(int8_t h2) const
+    {
+        return groupMask(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(h2)))));
+    }
+    groupMask matchEmpty() const
+    {
+        return match(CTRL_EMPTY);
+    }
+    //空和已删除的最高位都是1
+    groupMask matchFree() const
+    {
+        return groupMask(uint32_t(_mm_movemask_epi8(v)));
+    }
+#else
+    const int8_t* p;
+    explicit ctrlGroup(const int8_t* c) : p(c) {}
+
+    groupMask match(int8_t h2) const
+    {
+        uint32_t m = 0;
+        for(size_t i = 0; i<GROUP; i++)
+        {
+            m |= uint32_t(p[i] == h2) << i;
+        }
+        return groupMask(m);
+    }
+    groupMask matchEmpty() const
+    {
+        return match(CTRL_EMPTY);
+    }
+    groupMask matchFree() const
+    {
+        uint32_t m = 0;
+        for(size_t i = 0; i<GROUP; i++)
+        {
+            m |= uint32_t(p[i] < 0) << i;
+        }
+        return groupMask(m);
+    }
+#endif
+};
+
+//字符串哈希, string/string_view/const char*都能直接算
+struct stringHash
+{
+    typedef void is_transparent;
+    size_t operator()(string_view s) const { return hash<string_view>()(s); }
+};
+
+struct stringEqual
+{
+    typedef void is_transparent;
+    bool operator()(string_view a, string_view b) const { return a == b; }
+};
+
+template<class K, class V, class Hash = hash<K>, class Eq = equal_to<K>>
+class flatHashMap
+{
+public:
+    typedef pair<const K, V> value_type;
+
+    //Const为true时是const_iterator, 只能读
+    template<bool Const>
+    class iteratorBase
+    {
+    public:
+        typedef typename conditional<Const, const value_type, value_type>::type element;
+
+        iteratorBase() : map(NULL), idx(0) {}
+        iteratorBase(const flatHashMap* m, size_t i) : map(m), idx(i)
+        {
+            skip();
+        }
+        //iterator可以转成const_iterator, 反过来不行
+        template<bool C, class = typename enable_if<Const && !C>::type>
+        iteratorBase(const iteratorBase<C>& r) : map(r.map), idx(r.idx) {}
+
+        element& operator*() const { return map->slots[idx]; }
+        element* operator->() const { return &map->slots[idx]; }
+        iteratorBase& operator++()
+        {
+            idx++;
+            skip();
+            return *this;
+        }
+        bool operator==(const iteratorBase& r) const { return idx == r.idx; }
+        bool operator!=(const iteratorBase& r) const { return idx != r.idx; }
+
+    private:
+        void skip()
+        {
+            while(idx < map->cap && map->ctrl[idx] < 0)
+            {
+                idx++;
+            }
+        }
+
+        const flatHashMap* map;
+        size_t idx;
+        friend class flatHashMap;
+        friend class iteratorBase<!Const>;
+    };
+
+    typedef iteratorBase<false> iterator;
+    typedef iteratorBase<true> const_iterator;
+
+    flatHashMap() : ctrl(NULL), slots(NULL), cap(0), len(0), growthLeft(0) {}
+
+    ~flatHashMap()
+    {
+        destroyAll();
+    }
+
+    flatHashMap(const flatHashMap&) = delete;
+    flatHashMap& operator=(const flatHashMap&) = delete;
+
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    size_t capacity() const { return cap; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, cap); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, cap); }
+
+    //保证插入n个元素之前不会再扩容
+    void reserve(size_t n)
+    {
+        size_t c = GROUP;
+        while(c * 7 / 8 < n)
+        {
+            c *= 2;
+        }
+        if(c > cap)
+        {
+            rehash(c);
+        }
+    }
+
+    //预先算好的哈希值, 同一个key要查很多次或者跨多个表查找时可以复用
+    template<class Q>
+    size_t hash_of(const Q& key) const
+    {
+        return mix(hasher(key));
+    }
+
+    template<class Q>
+    iterator find(const Q& key)
+    {
+        return find(key, hash_of(key));
+    }
+
+    template<class Q>
+    const_iterator find(const Q& key) const
+    {
+        return find(key, hash_of(key));
+    }
+
+    template<class Q>
+    iterator find(const Q& key, size_t h)
+    {
+        size_t i = findIndex(key, h);
+        return iterator(this, i == NPOS ? cap : i);
+    }
+
+    template<class Q>
+    const_iterator find(const Q& key, size_t h) const
+    {
+        size_t i = findIndex(key, h);
+        return const_iterator(this, i == NPOS ? cap : i);
+    }
+
+    template<class Q>
+    bool contains(const Q& key) const
+    {
+        return cap != 0 && findIndex(key, hash_of(key)) != NPOS;
+    }
+
+    //key不存在时用args构造value, 存在时什么也不做
+    template<class... Args>
+    pair<iterator, bool> try_emplace(const K& key, Args&&... args)
+    {
+        return try_emplace_hashed(hash_of(key), key, std::forward<Args>(args)...);
+    }
+
+    template<class... Args>
+    pair<iterator, bool> try_emplace_hashed(size_t h, const K& key, Args&&... args)
+    {
+        size_t i = findIndex(key, h);
+        if(i != NPOS)
+        {
+            return make_pair(iterator(this, i), false);
+        }
+        if(growthLeft == 0)
+        {
+            //槽位大多是已删除的标记时不扩容, 按原大小重建一次把标记清掉
+            //否则插入/删除反复交替、元素个数不变时容量也会一直翻倍
+            if(cap != 0 && len <= cap * 7 / 16)
+            {
+                rehash(cap);
+            }
+            else
+            {
+                rehash(cap == 0 ? GROUP : cap * 2);
+            }
+        }
+        i = findFree(h);
+        //先构造再标记: 构造抛异常时这个槽位还是空的, 表保持原样
+        new(&slots[i]) value_type(piecewise_construct, forward_as_tuple(key), forward_as_tuple(std::forward<Args>(args)...));
+        if(ctrl[i] == CTRL_EMPTY)
+        {
+            growthLeft--;
+        }
+        ctrl[i] = h2(h);
+        len++;
+        return make_pair(iterator(this, i), true);
+    }
+
+    pair<iterator, bool> insert(const value_type& v)
+    {
+        return try_emplace(v.first, v.second);
+    }
+
+    V& operator[](const K& key)
+    {
+        return try_emplace(key).first->second;
+    }
+
+    template<class Q>
+    size_t erase(const Q& key)
+    {
+        if(cap == 0)
+        {
+            return 0;
+        }
+        size_t i = findIndex(key, hash_of(key));
+        if(i == NPOS)
+        {
+            return 0;
+        }
+        slots[i].~value_type();
+        //组里还有空位说明探测不会越过这一组, 可以直接标成空; 否则只能标成已删除
+        size_t g = i & ~(GROUP - 1);
+        if(ctrlGroup(ctrl + g).matchEmpty().any())
+        {
+            ctrl[i] = CTRL_EMPTY;
+            growthLeft++;
+        }
+        else
+        {
+            ctrl[i] = CTRL_DELETED;
+        }
+        len--;
+        return 1;
+    }
+
+private:
+    static const size_t NPOS = size_t(-1);
+
+    //std::hash对整数是恒等映射, 再混一次让高低位都分布均匀
+    static size_t mix(size_t h)
+    {
+        uint64_t x = uint64_t(h) * 0x9E3779B97F4A7C15ull;
+        return size_t(x ^ (x >> 32));
+    }
+
+    static int8_t h2(size_t h) { return int8_t(h & 0x7F); }
+    size_t h1(size_t h) const { return h >> 7; }
+
+    template<class Q>
+    size_t findIndex(const Q& key, size_t h) const
+    {
+        if(cap == 0)
+        {
+            return NPOS;
+        }
+        size_t groups = cap / GROUP;
+        size_t g = h1(h) & (groups - 1);
+        int8_t tag = h2(h);
+        for(size_t step = 1; step <= groups; step++)
+        {
+            ctrlGroup grp(ctrl + g * GROUP);
+            for(groupMask m = grp.match(tag); m.any(); m.clearLowest())
+            {
+                size_t i = g * GROUP + m.lowest();
+                if(equal(slots[i].first, key))
+                {
+                    return i;
+                }
+            }
+            if(grp.matchEmpty().any())
+            {
+                return NPOS;
+            }
+            g = (g + step) & (groups - 1); //三角数探测, 组数是2的幂时能走遍所有组
+        }
+        return NPOS;
+    }
+
+    size_t findFree(size_t h) const
+    {
+        size_t groups = cap / GROUP;
+        size_t g = h1(h) & (groups - 1);
+        for(size_t step = 1; ; step++)
+        {
+            groupMask m = ctrlGroup(ctrl + g * GROUP).matchFree();
+            if(m.any())
+            {
+                return g * GROUP + m.lowest();
+            }
+            g = (g + step) & (groups - 1);
+        }
+    }
+
+    void rehash(size_t newCap)
+    {
+        int8_t* oldCtrl = ctrl;
+        value_type* oldSlots = slots;
+        size_t oldCap = cap;
+
+        ctrl = new int8_t[newCap];
+        memset(ctrl, CTRL_EMPTY, newCap);
+        slots = static_cast<value_type*>(::operator new(newCap * sizeof(value_type)));
+        cap = newCap;
+        growthLeft = newCap * 7 / 8;
+
+        for(size_t i = 0; i<oldCap; i++)
+        {
+            if(oldCtrl[i] >= 0)
+            {
+                size_t h = hash_of(oldSlots[i].first);
+                size_t j = findFree(h);
+                ctrl[j] = h2(h);
+                new(&slots[j]) value_type(std::move(const_cast<K&>(oldSlots[i].first)), std::move(oldSlots[i].second));
+                oldSlots[i].~value_type();
+                growthLeft--;
+            }
+        }
+        delete[] oldCtrl;
+        ::operator delete(oldSlots);
+    }
+
+    void destroyAll()
+    {
+        for(size_t i = 0; i<cap; i++)
+        {
+            if(ctrl[i] >= 0)
+            {
+                slots[i].~value_type();
+            }
+        }
+        delete[] ctrl;
+        ::operator delete(slots);
+    }
+
+    int8_t* ctrl;
+    value_type* slots;
+    size_t cap;
+    size_t len;
+    size_t growthLeft;
+    Hash hasher;
+    Eq equal;
+};
+
+//构造时检查年龄
+struct checkedAge
+{
+    checkedAge(int a) : age(a)
+    {
+        if(a < 0)
+        {
+            throw invalid_argument("negative age");
+        }
+    }
+
+    int age;
+};
+
+void test01()
+{
+    pair<string, int>p1 = make_pair("xiaoming", 20);
+
+    flatHashMap<string, int, stringHash, stringEqual> ages;
+    ages.insert(p1);
+    ages["zhangsan"] = 10;
+    ages["lisi"] = 10;
+    ages.try_emplace("wangwun", 30);
+    ages.try_emplace("wangwun", 99); //已经存在, 不会覆盖
+
+    //直接用string_view查找, 不构造string
+    const char line[] = "lisi,wangwun,nobody";
+    string_view names[] = { string_view(line, 4), string_view(line + 5, 7), string_view(line + 13, 6) };
+    for(int i = 0; i<3; i++)
+    {
+        flatHashMap<string, int, stringHash, stringEqual>::iterator it = ages.find(names[i]);
+        cout<<names[i]<<": "<<(it != ages.end() ? to_string(it->second) : string("not found"))<<endl;
+    }
+
+    //哈希值算一次, 用在多次查找里
+    size_t h = ages.hash_of(string_view("xiaoming"));
+    cout<<"xiaoming: "<<ages.find(string_view("xiaoming"), h)->second<<endl;
+
+    ages.erase(string_view("lisi"));
+    const flatHashMap<string, int, stringHash, stringEqual>& cages = ages;
+    for(flatHashMap<string, int, stringHash, stringEqual>::const_iterator it = cages.begin(); it != cages.end(); ++it)
+    {
+        cout<<it->first<<"="<<it->second<<" ";
+    }
+    cout<<"size "<<ages.size()<<endl;
+
+    //值的构造函数抛异常时不留下半个元素
+    flatHashMap<int, checkedAge> checked;
+    checked.try_emplace(1, 20);
+    try
+    {
+        checked.try_emplace(2, -1);
+    }
+    catch(const invalid_argument& e)
+    {
+        cout<<"error: "<<e.what()<<", size "<<checked.size()<<", find(2) "<<(checked.find(2) == checked.end() ? "not found" : "FOUND")<<endl;
+    }
+}
+
+void test02()
+{
+    //整数key, 大量插入删除后和unordered_map对照
+    flatHashMap<int, int> m;
+    unordered_map<int, int> u;
+    for(int i = 0; i<200000; i++)
+    {
+        int k = (i * 7919) % 100003;
+        m[k] += i;
+        u[k] += i;
+        if(i % 3 == 0)
+        {
+            m.erase((i * 31) % 100003);
+            u.erase((i * 31) % 100003);
+        }
+    }
+    bool ok = m.size() == u.size();
+    for(unordered_map<int, int>::iterator it = u.begin(); it != u.end(); ++it)
+    {
+        flatHashMap<int, int>::iterator f = m.find(it->first);
+        ok = ok && f != m.end() && f->second == it->second;
+    }
+    cout<<"check against unordered_map: "<<(ok ? "ok" : "FAILED")<<endl;
+
+    //元素个数一直是1000, 反复插入新key删除旧key, 容量不应该跟着涨
+    flatHashMap<int, int> churn;
+    for(int i = 0; i<1000; i++)
+    {
+        churn[i] = i;
+    }
+    size_t startCap = churn.capacity();
+    size_t maxCap = startCap;
+    for(int i = 1000; i<2000000; i++)
+    {
+        churn[i] = i;
+        churn.erase(i - 1000);
+        maxCap = max(maxCap, churn.capacity());
+    }
+    cout<<"churn: size "<<churn.size()<<", capacity "<<startCap<<" -> max "<<maxCap
+        <<(churn.size() == 1000 && maxCap <= startCap * 2 ? " ok" : " FAILED")<<endl;
+}
+
+void test03()
+{
+    //一百万个名字, 查找的key来自一整块文本里的string_view
+    const int n = 1000000;
+    string text;
+    vector<pair<size_t, size_t>> spans;
+    for(int i = 0; i<n; i++)
+    {
+        string name = "preson_" + to_string(i * 2654435761u % 100000007u);
+        spans.push_back(make_pair(text.size(), name.size()));
+        text += name;
+    }
+
+    map<string, int> tree;
+    unordered_map<string, int> hashed;
+    flatHashMap<string, int, stringHash, stringEqual> flat;
+    flat.reserve(n);
+    hashed.reserve(n);
+    for(int i = 0; i<n; i++)
+    {
+        string key = text.substr(spans[i].first, spans[i].second);
+        tree[key] = i;
+        hashed[key] = i;
+        flat.try_emplace(key, i);
+    }
+
+    long long s1 = 0, s2 = 0, s3 = 0;
+    auto t0 = chrono::steady_clock::now();
+    for(int i = n - 1; i >= 0; i--)
+    {
+        s1 += tree.find(string(text, spans[i].first, spans[i].second))->second;
+    }
+    auto t1 = chrono::steady_clock::now();
+    for(int i = n - 1; i >= 0; i--)
+    {
+        s2 += hashed.find(string(text, spans[i].first, spans[i].second))->second;
+    }
+    auto t2 = chrono::steady_clock::now();
+    for(int i = n - 1; i >= 0; i--)
+    {
+        s3 += flat.find(string_view(text).substr(spans[i].first, spans[i].second))->second;
+    }
+    auto t3 = chrono::steady_clock::now();
+
+    cout<<"map "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms, unordered_map "
+        <<chrono::duration<double, milli>(t2 - t1).count()<<" ms, flatHashMap "
+        <<chrono::duration<double, milli>(t3 - t2).count()<<" ms ("
+        <<(s1 == s2 && s2 == s3 ? "same" : "DIFFERENT")<<")"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+    test03();
+    system("pause");
+}
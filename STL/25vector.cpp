@@ -0,0 +1,414 @@
+#include<iostream>
+#include<vector>
+#include<map>
+#include<string>
+#include<algorithm>
+#include<chrono>
+#include<new>
+#include<mutex>
+#include<type_traits>
+#include<utility>
+#include<initializer_list>
+#include<cstddef>
+#include<cstdlib>
+using namespace std;
+
+//small_vector<T, N>: 前N个元素放在对象内部, 超过N个才去堆上申请
+//很多vector一辈子不超过8个元素, 这样就完全不用new
+//
+//统计模式: 编译时加 -DSMALL_VECTOR_STATS
+//每个small_vector记住自己是在哪一行创建的, 析构时把重新分配次数和最大时的大小汇总到这一行,
+//程序退出时按行打印, 用来决定N该取多少、哪里该提前reserve
+
+#ifdef SMALL_VECTOR_STATS
+//默认参数里的__builtin_FILE/__builtin_LINE取的是调用者的位置
+struct callSite
+{
+    const char* file;
+    int line;
+    callSite(const char* f = __builtin_FILE(), int l = __builtin_LINE()) : file(f), line(l) {}
+};
+
+struct siteStats
+{
+    size_t vectors = 0;
+    size_t reallocations = 0;
+    size_t spilled = 0;             //超过内置容量的个数
+    size_t inlineCapacity = 0;
+    vector<size_t> peakSizes;       //每个vector最多时有几个元素
+};
+
+class smallVectorRegistry
+{
+public:
+    static smallVectorRegistry& get()
+    {
+        static smallVectorRegistry r;
+        return r;
+    }
+
+    //每个线程里的small_vector析构时都会来记一笔
+    void record(const callSite& site, size_t inlineCap, size_t reallocs, size_t maxSize)
+    {
+        lock_guard<mutex> g(lock);
+        siteStats& s = sites[make_pair(string(site.file), site.line)];
+        s.vectors++;
+        s.reallocations += reallocs;
+        s.spilled += maxSize > inlineCap ? 1 : 0;
+        s.inlineCapacity = inlineCap;
+        s.peakSizes.push_back(maxSize);
+    }
+
+    ~smallVectorRegistry()
+    {
+        report();
+    }
+
+    void report()
+    {
+        lock_guard<mutex> g(lock);
+        if(sites.empty())
+        {
+            return;
+        }
+        cerr<<"small_vector call sites:"<<endl;
+        for(map<pair<string, int>, siteStats>::iterator it = sites.begin(); it != sites.end(); ++it)
+        {
+            siteStats& s = it->second;
+            sort(s.peakSizes.begin(), s.peakSizes.end());
+            size_t p50 = s.peakSizes[s.peakSizes.size() / 2];
+            size_t p90 = s.peakSizes[s.peakSizes.size() * 9 / 10];
+            size_t p99 = s.peakSizes[s.peakSizes.size() * 99 / 100];
+            cerr<<"  "<<it->first.first<<":"<<it->first.second<<"  N="<<s.inlineCapacity
+                <<"  vectors="<<s.vectors<<"  reallocs="<<s.reallocations<<"  spilled="<<s.spilled
+                <<"  peak size p50/p90/p99/max="<<p50<<"/"<<p90<<"/"<<p99<<"/"<<s.peakSizes.back()<<endl;
+        }
+        sites.clear();
+    }
+
+private:
+    mutex lock;
+    map<pair<string, int>, siteStats> sites;
+};
+#define SV_SITE_PARAM , callSite site = callSite()
+#define SV_SITE_PARAM_ONLY callSite site = callSite()
+#define SV_SITE_INIT , site(site), reallocs(0), maxSize(0)
+#else
+#define SV_SITE_PARAM
+#define SV_SITE_PARAM_ONLY
+#define SV_SITE_INIT
+#endif
+
+template<class T, size_t N>
+class small_vector
+{
+    static_assert(N > 0, "small_vector needs at least one inline slot, use vector otherwise");
+
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    small_vector(SV_SITE_PARAM_ONLY) : ptr(inlineData()), len(0), cap(N) SV_SITE_INIT {}
+
+    small_vector(size_t n, const T& value SV_SITE_PARAM) : ptr(inlineData()), len(0), cap(N) SV_SITE_INIT
+    {
+        reserve(n);
+        for(size_t i = 0; i<n; i++)
+        {
+            push_back(value);
+        }
+    }
+
+    small_vector(initializer_list<T> init SV_SITE_PARAM) : ptr(inlineData()), len(0), cap(N) SV_SITE_INIT
+    {
+        reserve(init.size());
+        for(const T& v : init)
+        {
+            push_back(v);
+        }
+    }
+
+    small_vector(const small_vector& r SV_SITE_PARAM) : ptr(inlineData()), len(0), cap(N) SV_SITE_INIT
+    {
+        reserve(r.len);
+        for(size_t i = 0; i<r.len; i++)
+        {
+            new(&ptr[i]) T(r.ptr[i]);
+        }
+        len = r.len;
+        noteSize();
+    }
+
+    //对方在堆上时直接拿走指针; 在内部存储时只能逐个移动
+    small_vector(small_vector&& r SV_SITE_PARAM) noexcept(is_nothrow_move_constructible<T>::value) : ptr(inlineData()), len(0), cap(N) SV_SITE_INIT
+    {
+        takeFrom(r);
+    }
+
+    small_vector& operator=(const small_vector& r)
+    {
+        if(this != &r)
+        {
+            clear();
+            reserve(r.len);
+            for(size_t i = 0; i<r.len; i++)
+            {
+                new(&ptr[i]) T(r.ptr[i]);
+            }
+            len = r.len;
+            noteSize();
+        }
+        return *this;
+    }
+
+    small_vector& operator=(small_vector&& r) noexcept(is_nothrow_move_constructible<T>::value)
+    {
+        if(this != &r)
+        {
+            clear();
+            freeHeap();
+            takeFrom(r);
+        }
+        return *this;
+    }
+
+    ~small_vector()
+    {
+#ifdef SMALL_VECTOR_STATS
+        smallVectorRegistry::get().record(site, N, reallocs, maxSize);
+#endif
+        clear();
+        freeHeap();
+    }
+
+    size_t size() const { return len; }
+    size_t capacity() const { return cap; }
+    bool empty() const { return len == 0; }
+    bool is_inline() const { return ptr == inlineData(); }
+
+    T& operator[](size_t i) { return ptr[i]; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+    T& back() { return ptr[len - 1]; }
+    T* data() { return ptr; }
+
+    iterator begin() { return ptr; }
+    iterator end() { return ptr + len; }
+    const_iterator begin() const { return ptr; }
+    const_iterator end() const { return ptr + len; }
+
+    void reserve(size_t n)
+    {
+        if(n > cap)
+        {
+            grow(n);
+        }
+    }
+
+    void push_back(const T& v)
+    {
+        emplace_back(v);
+    }
+
+    //满了的时候先在新内存里构造新元素, 再把旧元素搬过去
+    //参数可能引用的是自己里面的元素(v.emplace_back(v[0])), 这样它被移走之前就已经用完了
+    template<class... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if(len == cap)
+        {
+            size_t newCap = cap * 2;
+            T* nb = static_cast<T*>(::operator new(newCap * sizeof(T)));
+            try
+            {
+                new(&nb[len]) T(std::forward<Args>(args)...);
+            }
+            catch(...)
+            {
+                ::operator delete(nb);
+                throw;
+            }
+            moveTo(nb, newCap);
+        }
+        else
+        {
+            new(&ptr[len]) T(std::forward<Args>(args)...);
+        }
+        len++;
+        noteSize();
+        return ptr[len - 1];
+    }
+
+    void pop_back()
+    {
+        ptr[--len].~T();
+    }
+
+    void clear()
+    {
+        for(size_t i = 0; i<len; i++)
+        {
+            ptr[i].~T();
+        }
+        len = 0;
+    }
+
+private:
+    T* inlineData() { return reinterpret_cast<T*>(storage); }
+    const T* inlineData() const { return reinterpret_cast<const T*>(storage); }
+
+    void grow(size_t newCap)
+    {
+        moveTo(static_cast<T*>(::operator new(newCap * sizeof(T))), newCap);
+    }
+
+    //把现有的len个元素搬到nb, 之后nb就是新的存储
+    void moveTo(T* nb, size_t newCap)
+    {
+        for(size_t i = 0; i<len; i++)
+        {
+            new(&nb[i]) T(std::move(ptr[i]));
+            ptr[i].~T();
+        }
+        freeHeap();
+        ptr = nb;
+        cap = newCap;
+#ifdef SMALL_VECTOR_STATS
+        reallocs++;
+#endif
+    }
+
+    void freeHeap()
+    {
+        if(!is_inline())
+        {
+            ::operator delete(ptr);
+            ptr = inlineData();
+            cap = N;
+        }
+    }
+
+    void takeFrom(small_vector& r)
+    {
+        if(!r.is_inline())
+        {
+            ptr = r.ptr;
+            cap = r.cap;
+            len = r.len;
+            r.ptr = r.inlineData();
+            r.cap = N;
+            r.len = 0;
+        }
+        else
+        {
+            for(size_t i = 0; i<r.len; i++)
+            {
+                new(&ptr[i]) T(std::move(r.ptr[i]));
+            }
+            len = r.len;
+            r.clear();
+        }
+        noteSize();
+    }
+
+    void noteSize()
+    {
+#ifdef SMALL_VECTOR_STATS
+        maxSize = max(maxSize, len);
+#endif
+    }
+
+    T* ptr;
+    size_t len;
+    size_t cap;
+    alignas(T) unsigned char storage[N * sizeof(T)];
+#ifdef SMALL_VECTOR_STATS
+    callSite site;
+    size_t reallocs;
+    size_t maxSize;
+#endif
+};
+
+template<class V>
+void printVector(V& v)
+{
+    for(typename V::iterator it = v.begin(); it<v.end(); it++)
+    {
+        cout<<*it<<" ";
+    }
+    cout<<endl;
+}
+
+void test01()
+{
+    small_vector<int, 8> v1;
+    for( int i=0; i<20; i++)
+    {
+        v1.push_back(i);
+    }
+    printVector(v1);
+    cout<<"inline: "<<v1.is_inline()<<", capacity "<<v1.capacity()<<endl;
+
+    small_vector<int, 8> v3(5, 2);
+    printVector(v3);
+    cout<<"inline: "<<v3.is_inline()<<endl;
+
+    small_vector<int, 8> v4(v3);
+    small_vector<int, 8> v5(std::move(v1));
+    printVector(v4);
+    cout<<"moved: size "<<v5.size()<<", source size "<<v1.size()<<endl;
+
+    small_vector<string, 4> names = {"zhangsan", "lisi", "wangwun"};
+    names.emplace_back("zhaoliu");
+    names.emplace_back("caoqi");
+    printVector(names);
+
+    //满的时候把自己的元素再放进去一次
+    small_vector<string, 2> two = {"liubei", "guanyu"};
+    two.emplace_back(two[0]);
+    two.push_back(two[1]);
+    printVector(two);
+}
+
+void test02()
+{
+    //一百万个小数组, 大小在0到10之间
+    const int n = 1000000;
+    auto t0 = chrono::steady_clock::now();
+    long long s1 = 0;
+    for(int i = 0; i<n; i++)
+    {
+        vector<int> v;
+        for(int k = 0; k < i % 11; k++)
+        {
+            v.push_back(k);
+        }
+        s1 += v.size();
+    }
+    auto t1 = chrono::steady_clock::now();
+    long long s2 = 0;
+    for(int i = 0; i<n; i++)
+    {
+        small_vector<int, 8> v;
+        for(int k = 0; k < i % 11; k++)
+        {
+            v.push_back(k);
+        }
+        s2 += v.size();
+    }
+    auto t2 = chrono::steady_clock::now();
+
+    cout<<"vector "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms, small_vector<int, 8> "
+        <<chrono::duration<double, milli>(t2 - t1).count()<<" ms ("<<(s1 == s2 ? "same" : "DIFFERENT")<<")"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+#ifdef SMALL_VECTOR_STATS
+    smallVectorRegistry::get().report();
+#endif
+
+    system("pause");
+}
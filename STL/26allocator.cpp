@@ -0,0 +1,611 @@
+#include<iostream>
+#include<memory_resource>
+#include<vector>
+#include<deque>
+#include<list>
+#include<set>
+#include<string>
+#include<atomic>
+#include<mutex>
+#include<thread>
+#include<memory>
+#include<chrono>
+#include<algorithm>
+#include<cstddef>
+#include<cstdint>
+using namespace std;
+
+//给所有容器用的内存资源(std::pmr::memory_resource)
+//arenaResource      : 单调递增的分配区, 分配就是挪指针, 释放什么也不做, release()一次全部还掉
+//fixedPoolResource  : 固定大小的块池, 给list/set这种一个节点一个节点分配的容器用
+//threadCacheResource: 每个线程自己缓存一些空闲块, 大部分分配不用加锁, 缓存空了再去共享池里批量取
+//每个资源都记录当前占用的字节数和峰值, 可以按子系统分别看内存用了多少
+
+class trackedResource : public pmr::memory_resource
+{
+public:
+    explicit trackedResource(const char* n) : name(n), live(0), peak(0), count(0) {}
+
+    size_t liveBytes() const { return live.load(memory_order_relaxed); }
+    size_t peakBytes() const { return peak.load(memory_order_relaxed); }
+    size_t allocations() const { return count.load(memory_order_relaxed); }
+
+    void printStats() const
+    {
+        cout<<name<<": live "<<liveBytes()<<" B, peak "<<peakBytes()<<" B, "<<allocations()<<" allocations"<<endl;
+    }
+
+protected:
+    void noteAlloc(size_t bytes)
+    {
+        size_t now = live.fetch_add(bytes, memory_order_relaxed) + bytes;
+        size_t p = peak.load(memory_order_relaxed);
+        while(now > p && !peak.compare_exchange_weak(p, now, memory_order_relaxed))
+        {
+        }
+        count.fetch_add(1, memory_order_relaxed);
+    }
+
+    void noteFree(size_t bytes)
+    {
+        live.fetch_sub(bytes, memory_order_relaxed);
+    }
+
+    void resetLive()
+    {
+        live.store(0, memory_order_relaxed);
+    }
+
+private:
+    const char* name;
+    atomic<size_t> live;
+    atomic<size_t> peak;
+    atomic<size_t> count;
+};
+
+class arenaResource : public trackedResource
+{
+public:
+    explicit arenaResource(const char* name, size_t firstChunk = 4096,
+                           pmr::memory_resource* up = pmr::get_default_resource())
+        : trackedResource(name), upstream(up), chunks(NULL), cur(NULL), left(0), nextSize(firstChunk) {}
+
+    ~arenaResource()
+    {
+        freeChunks();
+    }
+
+    //整个请求结束时调用, 不管分配了多少对象, 只需要把几个大块还回去
+    //最大的那块留着给下一个请求用, 这样请求大小稳定以后就不再向上游要内存
+    void release()
+    {
+        chunk* keep = chunks;
+        if(keep != NULL)
+        {
+            chunks = keep->next;
+            keep->next = NULL;
+        }
+        freeChunks();
+        chunks = keep;
+        if(keep != NULL)
+        {
+            cur = reinterpret_cast<char*>(keep) + sizeof(chunk);
+            left = keep->size - sizeof(chunk);
+        }
+        resetLive();
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t align) override
+    {
+        size_t pad = (align - reinterpret_cast<size_t>(cur) % align) % align;
+        if(cur == NULL || pad + bytes > left)
+        {
+            newChunk(bytes + align);
+            pad = (align - reinterpret_cast<size_t>(cur) % align) % align;
+        }
+        void* p = cur + pad;
+        cur += pad + bytes;
+        left -= pad + bytes;
+        noteAlloc(bytes);
+        return p;
+    }
+
+    void do_deallocate(void*, size_t bytes, size_t) override
+    {
+        noteFree(bytes);
+    }
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    struct chunk
+    {
+        chunk* next;
+        size_t size;
+    };
+
+    void freeChunks()
+    {
+        while(chunks != NULL)
+        {
+            chunk* next = chunks->next;
+            upstream->deallocate(chunks, chunks->size, alignof(max_align_t));
+            chunks = next;
+        }
+        cur = NULL;
+        left = 0;
+    }
+
+    //块大小每次翻倍, 块的数量是对数级的
+    void newChunk(size_t atLeast)
+    {
+        size_t size = max(nextSize, atLeast + sizeof(chunk));
+        nextSize = size * 2;
+        chunk* c = static_cast<chunk*>(upstream->allocate(size, alignof(max_align_t)));
+        c->next = chunks;
+        c->size = size;
+        chunks = c;
+        cur = reinterpret_cast<char*>(c) + sizeof(chunk);
+        left = size - sizeof(chunk);
+    }
+
+    pmr::memory_resource* upstream;
+    chunk* chunks;
+    char* cur;
+    size_t left;
+    size_t nextSize;
+};
+
+//所有不超过blockSize的请求都给一个blockSize的块, 更大的请求转给上游
+class fixedPoolResource : public trackedResource
+{
+public:
+    fixedPoolResource(const char* name, size_t block, size_t blocksPerSlab = 256,
+                      pmr::memory_resource* up = pmr::get_default_resource())
+        : trackedResource(name), upstream(up), blockSize(max(roundUp(block), sizeof(void*))),
+          perSlab(blocksPerSlab), freeList(NULL) {}
+
+    ~fixedPoolResource()
+    {
+        for(size_t i = 0; i<slabs.size(); i++)
+        {
+            upstream->deallocate(slabs[i], blockSize * perSlab, alignof(max_align_t));
+        }
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t align) override
+    {
+        noteAlloc(bytes);
+        if(bytes > blockSize || align > alignof(max_align_t))
+        {
+            return upstream->allocate(bytes, align);
+        }
+        if(freeList == NULL)
+        {
+            refill();
+        }
+        freeBlock* b = freeList;
+        freeList = b->next;
+        return b;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t align) override
+    {
+        noteFree(bytes);
+        if(bytes > blockSize || align > alignof(max_align_t))
+        {
+            upstream->deallocate(p, bytes, align);
+            return;
+        }
+        freeBlock* b = static_cast<freeBlock*>(p);
+        b->next = freeList;
+        freeList = b;
+    }
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    struct freeBlock
+    {
+        freeBlock* next;
+    };
+
+    static size_t roundUp(size_t n)
+    {
+        size_t a = alignof(max_align_t);
+        return (n + a - 1) / a * a;
+    }
+
+    void refill()
+    {
+        char* slab = static_cast<char*>(upstream->allocate(blockSize * perSlab, alignof(max_align_t)));
+        slabs.push_back(slab);
+        for(size_t i = perSlab; i-- > 0; )
+        {
+            freeBlock* b = reinterpret_cast<freeBlock*>(slab + i * blockSize);
+            b->next = freeList;
+            freeList = b;
+        }
+    }
+
+    pmr::memory_resource* upstream;
+    size_t blockSize;
+    size_t perSlab;
+    freeBlock* freeList;
+    vector<char*> slabs;
+};
+
+//按2的幂分几档(16到512字节), 每档每个线程有自己的空闲链表
+//线程本地链表空了从共享链表一次取一批, 太长了还一批回去, 只有这两步需要加锁
+class threadCacheResource : public trackedResource
+{
+    static const int CLASSES = 6;
+    static const size_t MIN_BLOCK = 16;
+    static const size_t BATCH = 64;
+
+    struct freeBlock
+    {
+        freeBlock* next;
+    };
+
+    //共享状态只由资源自己持有(shared_ptr), 线程缓存里只记weak_ptr
+    //资源析构时slab立刻释放, 线程缓存里还剩的块直接丢掉, 不会把已经没用的资源拖到线程退出
+    struct shared
+    {
+        mutex lock;
+        freeBlock* lists[CLASSES] = {};
+        vector<char*> slabs;
+        pmr::memory_resource* upstream;
+
+        ~shared()
+        {
+            for(size_t i = 0; i<slabs.size(); i++)
+            {
+                upstream->deallocate(slabs[i], MIN_BLOCK << (CLASSES - 1) << 6, alignof(max_align_t));
+            }
+        }
+    };
+
+    struct localCache
+    {
+        uint64_t id;
+        weak_ptr<shared> state;
+        freeBlock* lists[CLASSES] = {};
+        size_t counts[CLASSES] = {};
+
+        //资源还在就把块还回去; 已经析构了的话这些块所在的slab也没了
+        ~localCache()
+        {
+            shared_ptr<shared> s = state.lock();
+            if(!s)
+            {
+                return;
+            }
+            lock_guard<mutex> g(s->lock);
+            for(int c = 0; c<CLASSES; c++)
+            {
+                while(lists[c] != NULL)
+                {
+                    freeBlock* b = lists[c];
+                    lists[c] = b->next;
+                    b->next = s->lists[c];
+                    s->lists[c] = b;
+                }
+            }
+        }
+    };
+
+public:
+    explicit threadCacheResource(const char* name, pmr::memory_resource* up = pmr::get_default_resource())
+        : trackedResource(name), state(make_shared<shared>()), id(nextId++)
+    {
+        state->upstream = up;
+    }
+
+    //当前线程还留着几个资源的缓存(测试用)
+    static size_t threadCacheCount()
+    {
+        return threadCaches().size();
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t align) override
+    {
+        noteAlloc(bytes);
+        int c = sizeClass(bytes);
+        if(c < 0 || align > alignof(max_align_t))
+        {
+            return state->upstream->allocate(bytes, align);
+        }
+        localCache& lc = cache();
+        if(lc.lists[c] == NULL)
+        {
+            fetchBatch(lc, c);
+        }
+        freeBlock* b = lc.lists[c];
+        lc.lists[c] = b->next;
+        lc.counts[c]--;
+        return b;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t align) override
+    {
+        noteFree(bytes);
+        int c = sizeClass(bytes);
+        if(c < 0 || align > alignof(max_align_t))
+        {
+            state->upstream->deallocate(p, bytes, align);
+            return;
+        }
+        localCache& lc = cache();
+        freeBlock* b = static_cast<freeBlock*>(p);
+        b->next = lc.lists[c];
+        lc.lists[c] = b;
+        if(++lc.counts[c] > BATCH * 2)
+        {
+            returnBatch(lc, c);
+        }
+    }
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    static int sizeClass(size_t bytes)
+    {
+        size_t size = MIN_BLOCK;
+        for(int c = 0; c<CLASSES; c++, size *= 2)
+        {
+            if(bytes <= size)
+            {
+                return c;
+            }
+        }
+        return -1;
+    }
+
+    static vector<unique_ptr<localCache>>& threadCaches()
+    {
+        thread_local vector<unique_ptr<localCache>> caches;
+        return caches;
+    }
+
+    //每个线程为每个资源保存一份缓存, 资源一般只有几个, 线性查找就够了
+    //按id找而不是按地址, 新资源正好分配在旧资源的地址上也不会认错
+    //没找到时顺便删掉资源已经析构的项, 每个请求建一个资源时缓存个数也不会一直涨
+    localCache& cache()
+    {
+        thread_local localCache* last = NULL;
+        if(last != NULL && last->id == id)
+        {
+            return *last;
+        }
+        vector<unique_ptr<localCache>>& caches = threadCaches();
+        last = NULL;
+        for(size_t i = 0; i<caches.size(); )
+        {
+            if(caches[i]->id == id)
+            {
+                last = caches[i].get();
+                i++;
+            }
+            else if(caches[i]->state.expired())
+            {
+                caches[i] = std::move(caches.back());
+                caches.pop_back();
+            }
+            else
+            {
+                i++;
+            }
+        }
+        if(last == NULL)
+        {
+            caches.push_back(unique_ptr<localCache>(new localCache()));
+            caches.back()->id = id;
+            caches.back()->state = state;
+            last = caches.back().get();
+        }
+        return *last;
+    }
+
+    void fetchBatch(localCache& lc, int c)
+    {
+        size_t block = MIN_BLOCK << c;
+        lock_guard<mutex> g(state->lock);
+        if(state->lists[c] == NULL)
+        {
+            //每个slab大小一样, 切成这一档的块
+            size_t slabBytes = (MIN_BLOCK << (CLASSES - 1)) << 6;
+            char* slab = static_cast<char*>(state->upstream->allocate(slabBytes, alignof(max_align_t)));
+            state->slabs.push_back(slab);
+            for(size_t off = 0; off + block <= slabBytes; off += block)
+            {
+                freeBlock* b = reinterpret_cast<freeBlock*>(slab + off);
+                b->next = state->lists[c];
+                state->lists[c] = b;
+            }
+        }
+        for(size_t i = 0; i<BATCH && state->lists[c] != NULL; i++)
+        {
+            freeBlock* b = state->lists[c];
+            state->lists[c] = b->next;
+            b->next = lc.lists[c];
+            lc.lists[c] = b;
+            lc.counts[c]++;
+        }
+    }
+
+    void returnBatch(localCache& lc, int c)
+    {
+        lock_guard<mutex> g(state->lock);
+        for(size_t i = 0; i<BATCH; i++)
+        {
+            freeBlock* b = lc.lists[c];
+            lc.lists[c] = b->next;
+            b->next = state->lists[c];
+            state->lists[c] = b;
+            lc.counts[c]--;
+        }
+    }
+
+    shared_ptr<shared> state;
+    uint64_t id;
+    static atomic<uint64_t> nextId;
+};
+
+atomic<uint64_t> threadCacheResource::nextId(1);
+
+class preson
+{
+public:
+    preson(const char* name, int age, pmr::memory_resource* mr) : pr_name(name, mr), pr_age(age) {}
+
+    pmr::string pr_name;
+    int pr_age;
+};
+
+void test01()
+{
+    //一个请求里用到的容器都从同一个arena分配, 请求结束时一次释放
+    arenaResource request("request arena");
+    {
+        pmr::vector<preson> v(&request);
+        v.emplace_back("zhangsan_with_a_long_name", 10, &request);
+        v.emplace_back("lisi_with_a_long_name"    , 10, &request);
+        v.emplace_back("wangwun_with_a_long_name" , 30, &request);
+        for(size_t i = 0; i<v.size(); i++)
+        {
+            cout<<"the name is:"<<v[i].pr_name<<" the age is:"<<v[i].pr_age<<endl;
+        }
+
+        pmr::deque<int> d(&request);
+        for(int i = 0; i<5; i++)
+        {
+            d.push_back(i);
+        }
+        request.printStats();
+    }
+    request.release();
+    request.printStats();
+
+    //节点容器用固定大小的池
+    fixedPoolResource nodes("node pool", 48);
+    {
+        pmr::list<int> l(&nodes);
+        pmr::set<int> s(&nodes);
+        for(int i = 0; i<1000; i++)
+        {
+            l.push_back(i);
+            s.insert(10 + i);
+        }
+        nodes.printStats();
+    }
+    nodes.printStats();
+
+    threadCacheResource shared("thread cache");
+    vector<thread> ws;
+    for(int t = 0; t<4; t++)
+    {
+        ws.push_back(thread([&shared]()
+        {
+            for(int round = 0; round<100; round++)
+            {
+                pmr::list<int> l(&shared);
+                for(int i = 0; i<1000; i++)
+                {
+                    l.push_back(i);
+                }
+            }
+        }));
+    }
+    for(size_t t = 0; t<ws.size(); t++)
+    {
+        ws[t].join();
+    }
+    shared.printStats();
+
+    //每个请求一个资源: 用完就析构, 这个线程的缓存表里不会留下它们
+    for(int request = 0; request<1000; request++)
+    {
+        threadCacheResource perRequest("per request");
+        pmr::vector<int> v(&perRequest);
+        v.push_back(request);
+    }
+    cout<<"thread caches after 1000 requests: "<<threadCacheResource::threadCacheCount()<<endl;
+}
+
+template<class MakeList>
+double timeLists(MakeList make)
+{
+    auto t0 = chrono::steady_clock::now();
+    for(int round = 0; round<20; round++)
+    {
+        make();
+    }
+    auto t1 = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(t1 - t0).count();
+}
+
+void test02()
+{
+    const int n = 200000;
+    double base = timeLists([n]()
+    {
+        list<int> l;
+        for(int i = 0; i<n; i++)
+        {
+            l.push_back(i);
+        }
+    });
+    fixedPoolResource pool("pool", 24);
+    double pooled = timeLists([n, &pool]()
+    {
+        pmr::list<int> l(&pool);
+        for(int i = 0; i<n; i++)
+        {
+            l.push_back(i);
+        }
+    });
+    arenaResource arena("arena");
+    double arenaMs = timeLists([n, &arena]()
+    {
+        {
+            pmr::list<int> l(&arena);
+            for(int i = 0; i<n; i++)
+            {
+                l.push_back(i);
+            }
+        }
+        arena.release();
+    });
+    threadCacheResource cached("thread cache");
+    double cachedMs = timeLists([n, &cached]()
+    {
+        pmr::list<int> l(&cached);
+        for(int i = 0; i<n; i++)
+        {
+            l.push_back(i);
+        }
+    });
+    cout<<"list<int> x20: new/delete "<<base<<" ms, fixed pool "<<pooled<<" ms, arena "<<arenaMs
+        <<" ms, thread cache "<<cachedMs<<" ms"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+
+    system("pause");
+}
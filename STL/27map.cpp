@@ -0,0 +1,354 @@
+#include<iostream>
+#include<string>
+#include<unordered_map>
+#include<vector>
+#include<utility>
+#include<functional>
+#include<mutex>
+#include<shared_mutex>
+#include<thread>
+#include<atomic>
+#include<optional>
+#include<chrono>
+#include<cstdint>
+using namespace std;
+
+//多线程同时往一个map里写: 整个map一把锁的话线程越多越慢
+//concurrentMap按哈希值的高位分成若干个分片(shard), 每个分片一把读写锁
+//不同分片上的操作互不影响, 读只拿共享锁, 可以和其他读同时进行
+//分片数取2的幂, 每个分片单独占缓存行, 避免两把锁挤在同一行里互相干扰
+//读写锁本身比普通mutex贵, 写多读少时用exclusiveMutex(读也拿独占锁)反而更快
+
+//把lock_shared映射成lock, 让普通mutex也能配shared_lock用
+class exclusiveMutex : public mutex
+{
+public:
+    void lock_shared() { lock(); }
+    void unlock_shared() { unlock(); }
+};
+
+template<class K, class V, class Hash = hash<K>, size_t SHARDS = 64, class Mutex = shared_mutex>
+class concurrentMap
+{
+    static_assert(SHARDS > 0 && (SHARDS & (SHARDS - 1)) == 0, "SHARDS must be a power of two");
+    static_assert(uint64_t(SHARDS) <= (uint64_t(1) << 63), "SHARDS must not exceed 2^63");
+
+    struct alignas(64) shard
+    {
+        mutable Mutex lock;
+        unordered_map<K, V, Hash> items;
+    };
+
+public:
+    //返回true表示新插入, false表示覆盖了原来的值
+    template<class M>
+    bool insert_or_assign(const K& key, M&& value)
+    {
+        shard& s = shardFor(key);
+        unique_lock<Mutex> g(s.lock);
+        return s.items.insert_or_assign(key, std::forward<M>(value)).second;
+    }
+
+    //在锁里对value做读-改-写, key不存在时先用init构造
+    //fn(V& value, bool inserted)
+    template<class Fn>
+    void upsert(const K& key, const V& init, Fn fn)
+    {
+        shard& s = shardFor(key);
+        unique_lock<Mutex> g(s.lock);
+        pair<typename unordered_map<K, V, Hash>::iterator, bool> r = s.items.try_emplace(key, init);
+        fn(r.first->second, r.second);
+    }
+
+    //返回的是拷贝, 锁放开以后别的线程改了也不影响
+    optional<V> find(const K& key) const
+    {
+        const shard& s = shardFor(key);
+        shared_lock<Mutex> g(s.lock);
+        typename unordered_map<K, V, Hash>::const_iterator it = s.items.find(key);
+        if(it == s.items.end())
+        {
+            return nullopt;
+        }
+        return it->second;
+    }
+
+    //在共享锁里直接访问value, 不用拷贝, fn里不要再去操作这个map
+    template<class Fn>
+    bool visit(const K& key, Fn fn) const
+    {
+        const shard& s = shardFor(key);
+        shared_lock<Mutex> g(s.lock);
+        typename unordered_map<K, V, Hash>::const_iterator it = s.items.find(key);
+        if(it == s.items.end())
+        {
+            return false;
+        }
+        fn(it->second);
+        return true;
+    }
+
+    bool erase(const K& key)
+    {
+        shard& s = shardFor(key);
+        unique_lock<Mutex> g(s.lock);
+        return s.items.erase(key) > 0;
+    }
+
+    size_t size() const
+    {
+        size_t n = 0;
+        for(size_t i = 0; i<SHARDS; i++)
+        {
+            shared_lock<Mutex> g(shards[i].lock);
+            n += shards[i].items.size();
+        }
+        return n;
+    }
+
+    //有元素的分片个数, 用来检查键是不是均匀分到了所有分片上
+    size_t used_shards() const
+    {
+        size_t n = 0;
+        for(size_t i = 0; i<SHARDS; i++)
+        {
+            shared_lock<Mutex> g(shards[i].lock);
+            n += shards[i].items.empty() ? 0 : 1;
+        }
+        return n;
+    }
+
+    //按顺序拿到所有分片的共享锁再拷贝, 得到某一时刻完整一致的快照
+    //写操作只锁一个分片, 所以按固定顺序加锁不会死锁
+    vector<pair<K, V>> snapshot() const
+    {
+        vector<shared_lock<Mutex>> guards;
+        guards.reserve(SHARDS);
+        size_t n = 0;
+        for(size_t i = 0; i<SHARDS; i++)
+        {
+            guards.emplace_back(shards[i].lock);
+            n += shards[i].items.size();
+        }
+        vector<pair<K, V>> out;
+        out.reserve(n);
+        for(size_t i = 0; i<SHARDS; i++)
+        {
+            out.insert(out.end(), shards[i].items.begin(), shards[i].items.end());
+        }
+        return out;
+    }
+
+    //逐个分片拷贝后遍历, 每个分片内部是一致的, 分片之间不保证
+    //遍历时不持有锁, fn里可以随便操作这个map
+    template<class Fn>
+    void for_each_snapshot(Fn fn) const
+    {
+        vector<pair<K, V>> part;
+        for(size_t i = 0; i<SHARDS; i++)
+        {
+            {
+                shared_lock<Mutex> g(shards[i].lock);
+                part.assign(shards[i].items.begin(), shards[i].items.end());
+            }
+            for(size_t j = 0; j<part.size(); j++)
+            {
+                fn(part[j].first, part[j].second);
+            }
+        }
+    }
+
+private:
+    static constexpr int log2Of(size_t n)
+    {
+        return n <= 1 ? 0 : 1 + log2Of(n / 2);
+    }
+
+    static const int SHARD_BITS = log2Of(SHARDS);
+
+    //unordered_map内部用的是哈希值的低位, 分片用乘法混合后的最高SHARD_BITS位, 两者不相关
+    static size_t shardIndex(const K& key)
+    {
+        if constexpr(SHARD_BITS == 0)
+        {
+            return 0;
+        }
+        uint64_t h = uint64_t(Hash()(key)) * 0x9E3779B97F4A7C15ULL;
+        return size_t(h >> (64 - SHARD_BITS));
+    }
+
+    shard& shardFor(const K& key) { return shards[shardIndex(key)]; }
+    const shard& shardFor(const K& key) const { return shards[shardIndex(key)]; }
+
+    shard shards[SHARDS];
+};
+
+class preson
+{
+public:
+    preson(string name = "", int age = 0) : pr_name(name), pr_age(age), pr_visits(0) {}
+
+    string pr_name;
+    int pr_age;
+    int pr_visits;
+};
+
+void test01()
+{
+    concurrentMap<string, preson> m;
+    m.insert_or_assign("zhangsan", preson("zhangsan", 10));
+    m.insert_or_assign("lisi", preson("lisi", 10));
+    m.insert_or_assign("wangwun", preson("wangwun", 30));
+    m.insert_or_assign("lisi", preson("lisi", 20));
+
+    //四个线程同时给每个人记访问次数
+    vector<thread> ws;
+    for(int t = 0; t<4; t++)
+    {
+        ws.push_back(thread([&m]()
+        {
+            const char* names[] = {"zhangsan", "lisi", "wangwun", "zhaoliu"};
+            for(int i = 0; i<1000; i++)
+            {
+                string name = names[i % 4];
+                m.upsert(name, preson(name, 0), [](preson& p, bool)
+                {
+                    p.pr_visits++;
+                });
+            }
+        }));
+    }
+    for(size_t t = 0; t<ws.size(); t++)
+    {
+        ws[t].join();
+    }
+
+    m.for_each_snapshot([](const string& k, const preson& p)
+    {
+        cout<<k<<": the age is:"<<p.pr_age<<" visits:"<<p.pr_visits<<endl;
+    });
+
+    optional<preson> p = m.find("lisi");
+    if(p)
+    {
+        cout<<"find lisi, the age is:"<<p->pr_age<<endl;
+    }
+    m.erase("zhaoliu");
+    cout<<"size after erase: "<<m.size()<<", snapshot size: "<<m.snapshot().size()<<endl;
+
+    //分片数超过64时高位取得更多, 每个分片都能分到键
+    concurrentMap<uint64_t, uint64_t, hash<uint64_t>, 256> big;
+    for(uint64_t k = 0; k<10000; k++)
+    {
+        big.insert_or_assign(k, k);
+    }
+    cout<<"256 shards, used: "<<big.used_shards()<<endl;
+}
+
+//对照组: 一个unordered_map加一把mutex
+class lockedMap
+{
+public:
+    void add(uint64_t key, uint64_t v)
+    {
+        lock_guard<mutex> g(lock);
+        items[key] += v;
+    }
+
+    bool contains(uint64_t key)
+    {
+        lock_guard<mutex> g(lock);
+        return items.count(key) > 0;
+    }
+
+private:
+    mutex lock;
+    unordered_map<uint64_t, uint64_t> items;
+};
+
+//每个线程做opsPerThread次操作: 3/4是写(累加), 1/4是读
+template<class Op>
+double runThreads(int threads, int opsPerThread, Op op)
+{
+    atomic<bool> go(false);
+    vector<thread> ws;
+    for(int t = 0; t<threads; t++)
+    {
+        ws.push_back(thread([&go, &op, t, opsPerThread]()
+        {
+            while(!go.load(memory_order_acquire))
+            {
+                this_thread::yield();
+            }
+            uint64_t x = uint64_t(t + 1) * 0x9E3779B97F4A7C15ULL;
+            for(int i = 0; i<opsPerThread; i++)
+            {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                //十万个不同的key; hash<uint64_t>是恒等映射, 连续的小整数放进一个大表里一个冲突也没有,
+                //打散一下才像真实的key
+                uint64_t key = (x % 100000) * 0xBF58476D1CE4E5B9ULL;
+                op(key ^ (key >> 31), (i & 3) == 0);
+            }
+        }));
+    }
+    auto t0 = chrono::steady_clock::now();
+    go.store(true, memory_order_release);
+    for(size_t t = 0; t<ws.size(); t++)
+    {
+        ws[t].join();
+    }
+    auto t1 = chrono::steady_clock::now();
+    return double(threads) * opsPerThread / chrono::duration<double>(t1 - t0).count() / 1e6;
+}
+
+template<class Map>
+double runSharded(int threads, int ops)
+{
+    Map sharded;
+    return runThreads(threads, ops, [&sharded](uint64_t key, bool read)
+    {
+        if(read)
+        {
+            sharded.visit(key, [](uint64_t) {});
+        }
+        else
+        {
+            sharded.upsert(key, 0, [](uint64_t& v, bool) { v++; });
+        }
+    });
+}
+
+void test02()
+{
+    const int ops = 200000;
+    cout<<"hardware threads: "<<thread::hardware_concurrency()<<endl;
+    for(int threads = 1; threads<=32; threads *= 2)
+    {
+        lockedMap single;
+        double a = runThreads(threads, ops, [&single](uint64_t key, bool read)
+        {
+            if(read)
+            {
+                single.contains(key);
+            }
+            else
+            {
+                single.add(key, 1);
+            }
+        });
+        double b = runSharded<concurrentMap<uint64_t, uint64_t, hash<uint64_t>, 64, exclusiveMutex>>(threads, ops);
+        double c = runSharded<concurrentMap<uint64_t, uint64_t>>(threads, ops);
+        cout<<threads<<" threads: one mutex "<<a<<" Mops/s, 64 shards (mutex) "<<b
+            <<" Mops/s, 64 shards (shared_mutex) "<<c<<" Mops/s"<<endl;
+    }
+}
+
+int main()
+{
+    test01();
+    test02();
+
+    system("pause");
+}
@@ -0,0 +1,264 @@
+#include<iostream>
+#include<vector>
+#include<algorithm>
+#include<random>
+#include<chrono>
+#include<cstring>
+#include<cstdint>
+#include<string>
+#include<type_traits>
+
+using namespace std;
+
+//基数排序(LSD)
+//整数和浮点数先映射成无符号key, 再按8位一个digit从低到高分配
+//浮点数: 正数翻转符号位, 负数全部取反, 这样无符号比较就和浮点比较一致
+
+template<class T, class Enable = void>
+struct radixTraits
+{
+    static const bool sortable = false;
+};
+
+//无符号整数, key就是本身
+template<class T>
+struct radixTraits<T, typename enable_if<is_integral<T>::value && is_unsigned<T>::value>::type>
+{
+    static const bool sortable = true;
+    typedef T key_type;
+    static key_type toKey(T v)
+    {
+        return v;
+    }
+};
+
+//有符号整数, 翻转符号位
+template<class T>
+struct radixTraits<T, typename enable_if<is_integral<T>::value && is_signed<T>::value>::type>
+{
+    static const bool sortable = true;
+    typedef typename make_unsigned<T>::type key_type;
+    static key_type toKey(T v)
+    {
+        return key_type(v) ^ (key_type(1) << (sizeof(T) * 8 - 1));
+    }
+};
+
+template<>
+struct radixTraits<float>
+{
+    static const bool sortable = true;
+    typedef uint32_t key_type;
+    static key_type toKey(float v)
+    {
+        key_type bits;
+        memcpy(&bits, &v, sizeof(bits));
+        key_type mask = (bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+        return bits ^ mask;
+    }
+};
+
+template<>
+struct radixTraits<double>
+{
+    static const bool sortable = true;
+    typedef uint64_t key_type;
+    static key_type toKey(double v)
+    {
+        key_type bits;
+        memcpy(&bits, &v, sizeof(bits));
+        key_type mask = (bits >> 63) ? ~key_type(0) : (key_type(1) << 63);
+        return bits ^ mask;
+    }
+};
+
+//keyOf把元素映射成无符号key, buffer由调用者提供, 长度不小于len
+//排序是稳定的, 结果留在array里
+template<class R, class KeyOf>
+void radixsortBy(R* array, int len, R* buffer, KeyOf keyOf)
+{
+    typedef decltype(keyOf(array[0])) key_type;
+    const int passes = sizeof(key_type);
+
+    if(len < 2)
+    {
+        return;
+    }
+
+    //一次遍历统计所有digit的直方图
+    vector<size_t> count(passes * 256, 0);
+    for(int i = 0; i<len; i++)
+    {
+        key_type k = keyOf(array[i]);
+        for(int p = 0; p<passes; p++)
+        {
+            count[p * 256 + ((k >> (p * 8)) & 0xFF)]++;
+        }
+    }
+
+    R* src = array;
+    R* dst = buffer;
+    for(int p = 0; p<passes; p++)
+    {
+        size_t* c = &count[p * 256];
+
+        //这一位所有元素都相同, 分配不会改变顺序, 跳过
+        key_type first = (keyOf(src[0]) >> (p * 8)) & 0xFF;
+        if(c[first] == size_t(len))
+        {
+            continue;
+        }
+
+        size_t offset = 0;
+        for(int d = 0; d<256; d++)
+        {
+            size_t n = c[d];
+            c[d] = offset;
+            offset += n;
+        }
+
+        for(int i = 0; i<len; i++)
+        {
+            int d = (keyOf(src[i]) >> (p * 8)) & 0xFF;
+            dst[c[d]++] = std::move(src[i]);
+        }
+        swap(src, dst);
+    }
+
+    //奇数次分配后数据在buffer里, 搬回来
+    if(src != array)
+    {
+        for(int i = 0; i<len; i++)
+        {
+            array[i] = std::move(src[i]);
+        }
+    }
+}
+
+template<class T>
+void radixsort(T* array, int len, T* buffer)
+{
+    radixsortBy(array, len, buffer, [](const T& v) { return radixTraits<T>::toKey(v); });
+}
+
+//排序入口: 数值类型且数量较多时走基数排序, 否则走比较排序
+template<class T>
+void fastsort(T* array, int len)
+{
+    if constexpr(radixTraits<T>::sortable)
+    {
+        if(len >= 256)
+        {
+            vector<T> buffer(len);
+            radixsort(array, len, buffer.data());
+            return;
+        }
+    }
+    sort(array, array + len);
+}
+
+template<class T>
+void myprint(T arr[], int len)
+{
+    for(int i = 0; i<len; i++)
+    {
+        cout<<arr[i]<<" ";
+    }
+    cout<<endl;
+}
+
+class preson
+{
+public:
+    preson() {}
+    preson(string name, int age)
+    {
+        this->pr_name = name;
+        this->pr_age = age;
+    }
+
+    string pr_name;
+    int pr_age = 0;
+};
+
+void test01()
+{
+    int intArr[] = {4,2,9,3,-6,7,2,5,-100,0};
+    int len = sizeof(intArr) / sizeof(intArr[0]);
+    int buffer[sizeof(intArr) / sizeof(intArr[0])];
+    radixsort(intArr, len, buffer);
+    myprint(intArr, len);
+
+    float floatArr[] = {3.5f, -0.0f, -2.25f, 0.0f, 100.0f, -1e10f, 1e-10f, -1.0f};
+    len = sizeof(floatArr) / sizeof(floatArr[0]);
+    float fbuffer[sizeof(floatArr) / sizeof(floatArr[0])];
+    radixsort(floatArr, len, fbuffer);
+    myprint(floatArr, len);
+}
+
+void test02()
+{
+    //按年龄排序, 同龄的人保持原来的先后顺序
+    vector<preson> v;
+    v.push_back(preson("zhangsan", 30));
+    v.push_back(preson("lisi"    , 10));
+    v.push_back(preson("wangwun" , 30));
+    v.push_back(preson("zhaoliu" , 60));
+    v.push_back(preson("caoqi"   , 10));
+
+    vector<preson> buffer(v.size());
+    radixsortBy(v.data(), int(v.size()), buffer.data(),
+        [](const preson& p) { return radixTraits<int>::toKey(p.pr_age); });
+
+    for(vector<preson>::iterator it = v.begin(); it != v.end(); it++)
+    {
+        cout<<"the name is:"<<it->pr_name<<" the age is:"<<it->pr_age<<endl;
+    }
+}
+
+template<class T>
+void benchOne(const char* name, const vector<T>& data)
+{
+    vector<T> a(data);
+    vector<T> b(data);
+
+    auto t0 = chrono::steady_clock::now();
+    sort(a.begin(), a.end());
+    auto t1 = chrono::steady_clock::now();
+    fastsort(b.data(), int(b.size()));
+    auto t2 = chrono::steady_clock::now();
+
+    double ns1 = chrono::duration<double, nano>(t1 - t0).count() / data.size();
+    double ns2 = chrono::duration<double, nano>(t2 - t1).count() / data.size();
+    cout<<name<<" n="<<data.size()<<" std::sort "<<ns1<<" ns/elem, fastsort "<<ns2
+        <<" ns/elem, "<<(a == b ? "same" : "DIFFERENT")<<endl;
+}
+
+void test03()
+{
+    const int n = 10000000;
+    mt19937_64 rng(42);
+
+    vector<int> ints(n);
+    for(int i = 0; i<n; i++)
+    {
+        ints[i] = int(rng());
+    }
+    benchOne("int   ", ints);
+
+    vector<double> doubles(n);
+    normal_distribution<double> dist(0.0, 1000.0);
+    for(int i = 0; i<n; i++)
+    {
+        doubles[i] = dist(rng);
+    }
+    benchOne("double", doubles);
+}
+
+int main()
+{
+    test01();
+    test02();
+    test03();
+    system("pause");
+}
@@ -0,0 +1,305 @@
+#include<iostream>
+#include<vector>
+#include<deque>
+#include<sstream>
+#include<chrono>
+#include<algorithm>
+#include<charconv>
+#include<cstdio>
+#include<cstring>
+#include<type_traits>
+
+using namespace std;
+
+//批量数字输出
+//数字先格式化到一块大缓冲区里, 缓冲区满了或者flush时才调用一次fwrite
+//整数每次查表写两位, 浮点数用to_chars输出最短且能还原的形式
+//写文件失败(磁盘满、管道断开)后good()返回false, 之后的输出都丢掉, 和ostream的badbit一样
+
+static const char digitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+//把无符号整数写到p, 返回写完之后的位置
+inline char* writeUnsigned(char* p, unsigned long long v)
+{
+    char tmp[20];
+    char* end = tmp + sizeof(tmp);
+    char* q = end;
+    while(v >= 100)
+    {
+        unsigned idx = unsigned(v % 100) * 2;
+        v /= 100;
+        q -= 2;
+        q[0] = digitPairs[idx];
+        q[1] = digitPairs[idx + 1];
+    }
+    if(v >= 10)
+    {
+        q -= 2;
+        q[0] = digitPairs[v * 2];
+        q[1] = digitPairs[v * 2 + 1];
+    }
+    else
+    {
+        *--q = char('0' + v);
+    }
+    size_t n = end - q;
+    memcpy(p, q, n);
+    return p + n;
+}
+
+class outBuffer
+{
+public:
+    //一个数字最多占MIN_CAPACITY个字符, 缓冲区不能比它小
+    static constexpr size_t MIN_CAPACITY = 32;
+
+    outBuffer(FILE* f, size_t capacity = 1 << 20)
+        : file(f), buf(max(capacity, MIN_CAPACITY)), pos(0), ok(true)
+    {
+    }
+
+    ~outBuffer()
+    {
+        flush();
+    }
+
+    void flush()
+    {
+        writeOut(buf.data(), pos);
+        pos = 0;
+        if(ok && fflush(file) != 0)
+        {
+            ok = false;
+        }
+    }
+
+    bool good() const { return ok; }
+
+    outBuffer& operator<<(char c)
+    {
+        reserve(1);
+        buf[pos++] = c;
+        return *this;
+    }
+
+    outBuffer& operator<<(const char* s)
+    {
+        size_t n = strlen(s);
+        reserve(n);
+        if(n > buf.size())
+        {
+            writeOut(s, n);
+            return *this;
+        }
+        memcpy(&buf[pos], s, n);
+        pos += n;
+        return *this;
+    }
+
+    template<class T>
+    typename enable_if<is_integral<T>::value, outBuffer&>::type operator<<(T v)
+    {
+        reserve(24);
+        char* p = &buf[pos];
+        if constexpr(is_signed<T>::value)
+        {
+            unsigned long long u = (unsigned long long)v;
+            if(v < 0)
+            {
+                *p++ = '-';
+                u = 0 - u;
+            }
+            p = writeUnsigned(p, u);
+        }
+        else
+        {
+            p = writeUnsigned(p, v);
+        }
+        pos = p - buf.data();
+        return *this;
+    }
+
+    //float/double: 最短的能还原出同一个值的十进制
+    template<class T>
+    typename enable_if<is_floating_point<T>::value, outBuffer&>::type operator<<(T v)
+    {
+        reserve(MIN_CAPACITY);
+        to_chars_result r = to_chars(&buf[pos], &buf[pos] + MIN_CAPACITY, v);
+        pos = r.ptr - buf.data();
+        return *this;
+    }
+
+private:
+    void reserve(size_t n)
+    {
+        if(pos + n > buf.size())
+        {
+            writeOut(buf.data(), pos);
+            pos = 0;
+        }
+    }
+
+    void writeOut(const char* p, size_t n)
+    {
+        if(ok && n > 0 && fwrite(p, 1, n, file) != n)
+        {
+            ok = false;
+        }
+    }
+
+    FILE* file;
+    vector<char> buf;
+    size_t pos;
+    bool ok;
+};
+
+template<class T>
+void myprint(outBuffer& out, T arr[], int len)
+{
+    for(int i = 0; i<len; i++)
+    {
+        out<<arr[i]<<' ';
+    }
+    out<<'\n';
+}
+
+void printVector(outBuffer& out, vector<int>& v)
+{
+    for(vector<int>::iterator it = v.begin(); it<v.end(); it++)
+    {
+        out<<*it<<' ';
+    }
+    out<<'\n';
+}
+
+void printDeque(outBuffer& out, deque<int>& q)
+{
+    for(deque<int>::const_iterator it = q.begin(); it!=q.end(); it++)
+    {
+        out<<*it<<' ';
+    }
+    out<<'\n';
+}
+
+void test01()
+{
+    outBuffer out(stdout);
+
+    int intArr[] = {0, 7, 42, -1, -2147483647 - 1, 2147483647, 100, 99};
+    myprint(out, intArr, sizeof(intArr) / sizeof(intArr[0]));
+
+    double doubleArr[] = {0.1, 1.0 / 3, -2.5, 1e300, 5e-324, 123456789.0};
+    myprint(out, doubleArr, sizeof(doubleArr) / sizeof(doubleArr[0]));
+
+    vector<int> v;
+    for(int i = 0; i<20; i++)
+    {
+        v.push_back(i);
+    }
+    printVector(out, v);
+
+    deque<int> d(10, 100);
+    printDeque(out, d);
+
+    //容量给0也能用, 会被调成MIN_CAPACITY
+    out.flush();
+    outBuffer tiny(stdout, 0);
+    tiny<<"tiny buffer: "<<-1234567890123456789LL<<' '<<-1.2345678901234567e-300<<'\n';
+    tiny.flush();
+
+#ifndef _WIN32
+    //写满的设备: 写失败以后good()变成false
+    FILE* full = fopen("/dev/full", "wb");
+    if(full != NULL)
+    {
+        outBuffer bad(full, 64);
+        for(int i = 0; i<100; i++)
+        {
+            bad<<i<<' ';
+        }
+        bad.flush();
+        out<<"write to /dev/full: "<<(bad.good() ? "good" : "failed")<<'\n';
+        fclose(full);
+    }
+#endif
+}
+
+void test02()
+{
+    const int n = 10000000;
+    vector<int> ints(n);
+    vector<double> doubles(n);
+    for(int i = 0; i<n; i++)
+    {
+        ints[i] = int((i * 7919LL) % 2000000000) - 1000000000;
+        doubles[i] = ints[i] / 1024.0;
+    }
+
+    //只比较格式化本身, 输出到内存里
+    auto t0 = chrono::steady_clock::now();
+    {
+        ostringstream os;
+        for(int i = 0; i<n; i++)
+        {
+            os<<ints[i]<<" ";
+        }
+    }
+    auto t1 = chrono::steady_clock::now();
+#ifdef _WIN32
+    FILE* null = fopen("NUL", "wb");
+#else
+    FILE* null = fopen("/dev/null", "wb");
+#endif
+    if(null == NULL)
+    {
+        return;
+    }
+    {
+        outBuffer out(null);
+        for(int i = 0; i<n; i++)
+        {
+            out<<ints[i]<<' ';
+        }
+    }
+    auto t2 = chrono::steady_clock::now();
+    {
+        ostringstream os;
+        os.precision(17);
+        for(int i = 0; i<n; i++)
+        {
+            os<<doubles[i]<<" ";
+        }
+    }
+    auto t3 = chrono::steady_clock::now();
+    {
+        outBuffer out(null);
+        for(int i = 0; i<n; i++)
+        {
+            out<<doubles[i]<<' ';
+        }
+    }
+    auto t4 = chrono::steady_clock::now();
+    fclose(null);
+
+    cout<<"int    ostream "<<chrono::duration<double, nano>(t1 - t0).count() / n<<" ns/elem, outBuffer "
+        <<chrono::duration<double, nano>(t2 - t1).count() / n<<" ns/elem"<<endl;
+    cout<<"double ostream "<<chrono::duration<double, nano>(t3 - t2).count() / n<<" ns/elem, outBuffer "
+        <<chrono::duration<double, nano>(t4 - t3).count() / n<<" ns/elem"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+    system("pause");
+}
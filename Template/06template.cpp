@@ -0,0 +1,251 @@
+#include<iostream>
+#include<fstream>
+#include<vector>
+#include<string>
+#include<algorithm>
+#include<random>
+#include<chrono>
+#include<cstdint>
+#include<cstdlib>
+#include<cstring>
+#include<climits>
+
+using namespace std;
+
+//排序基准测试
+//用固定种子生成各种分布的数据, 对每个排序算法测 ns/元素, 比较次数和交换次数, 结果输出成CSV
+//用法: 06template [最大规模] [csv文件], 默认最大规模 1<<20, 跑到 100000000 需要显式传参, 最大规模至少是16
+
+static long long g_compares = 0;
+static long long g_swaps = 0;
+
+template<class S>
+void myswap(S& a, S& b)
+{
+    S temp = a;
+    a = b;
+    b = temp;
+}
+
+template<class T>
+void mysort(T& array, int len)
+{
+    for(int i = 0; i<len; i++)
+    {
+        int max = i;
+        for(int j = i+1; j<len; j++)
+        {
+            if(array[j] < array[max])
+            {
+                max = j;
+            }
+        }
+        if(max != i)
+        {
+            myswap(array[max], array[i]);
+        }
+    }
+}
+
+//64字节的记录, 按key排序
+struct record
+{
+    uint32_t key;
+    char payload[60];
+
+    bool operator<(const record& r) const
+    {
+        return key < r.key;
+    }
+};
+
+//计数包装: 比较和交换都记一次, 只在统计次数的那一轮使用
+//std算法内部的单纯移动不算交换, 只有走到swap/myswap的才计数
+template<class T>
+struct counted
+{
+    T value;
+
+    bool operator<(const counted& r) const
+    {
+        g_compares++;
+        return value < r.value;
+    }
+
+    friend void swap(counted& a, counted& b)
+    {
+        g_swaps++;
+        T temp = a.value;
+        a.value = b.value;
+        b.value = temp;
+    }
+};
+
+template<class T>
+void myswap(counted<T>& a, counted<T>& b)
+{
+    swap(a, b);
+}
+
+inline void setKey(uint32_t& v, uint32_t k)
+{
+    v = k;
+}
+
+inline void setKey(record& r, uint32_t k)
+{
+    r.key = k;
+    memset(r.payload, int(k & 0xFF), sizeof(r.payload));
+}
+
+enum distribution {RANDOM, SORTED, REVERSE, ORGAN_PIPE, FEW_UNIQUE, NEARLY_SORTED, DIST_COUNT};
+
+const char* distName(int d)
+{
+    static const char* names[] = {"random", "sorted", "reverse", "organ_pipe", "few_unique", "nearly_sorted"};
+    return names[d];
+}
+
+template<class T>
+vector<T> makeInput(int dist, size_t n, uint64_t seed)
+{
+    mt19937_64 rng(seed);
+    vector<T> v(n);
+    for(size_t i = 0; i<n; i++)
+    {
+        uint32_t k = 0;
+        switch(dist)
+        {
+        case RANDOM:        k = uint32_t(rng()); break;
+        case SORTED:        k = uint32_t(i); break;
+        case REVERSE:       k = uint32_t(n - i); break;
+        case ORGAN_PIPE:    k = uint32_t(i < n / 2 ? i : n - i); break;
+        case FEW_UNIQUE:    k = uint32_t(rng() % 16); break;
+        case NEARLY_SORTED: k = uint32_t(i); break;
+        }
+        setKey(v[i], k);
+    }
+    if(dist == NEARLY_SORTED)
+    {
+        //打乱1%的位置
+        for(size_t i = 0; i < n / 100 + 1; i++)
+        {
+            size_t a = rng() % n;
+            size_t b = rng() % n;
+            swap(v[a], v[b]);
+        }
+    }
+    return v;
+}
+
+struct benchResult
+{
+    double nsPerElem;
+    long long compares;
+    long long swaps;
+};
+
+template<class T, class Sort>
+benchResult runOne(Sort sorter, const vector<T>& input)
+{
+    benchResult res;
+    size_t n = input.size();
+
+    //计时轮: 原始类型, 小规模重复多次, 直到累计超过20ms或者处理的元素够多
+    size_t maxReps = max<size_t>(1, (1 << 22) / max<size_t>(n, 1));
+    size_t reps = 0;
+    vector<T> work(n);
+    double total = 0;
+    while(reps < maxReps && (reps == 0 || total < 20e6))
+    {
+        reps++;
+        work = input;
+        auto t0 = chrono::steady_clock::now();
+        sorter(work.data(), int(n));
+        auto t1 = chrono::steady_clock::now();
+        total += chrono::duration<double, nano>(t1 - t0).count();
+    }
+    res.nsPerElem = total / reps / n;
+
+    //计数轮: 包装类型跑一次
+    vector<counted<T>> c(n);
+    for(size_t i = 0; i<n; i++)
+    {
+        c[i].value = input[i];
+    }
+    g_compares = 0;
+    g_swaps = 0;
+    sorter(c.data(), int(n));
+    res.compares = g_compares;
+    res.swaps = g_swaps;
+
+    if(!is_sorted(work.begin(), work.end()))
+    {
+        cerr<<"sort result is wrong!"<<endl;
+    }
+    return res;
+}
+
+template<class T, class Sort>
+void benchAlgo(ostream& csv, const char* algo, const char* type, Sort sorter, size_t maxN)
+{
+    //规模从16开始每次乘4, 最后补上最大规模本身
+    vector<size_t> sizes;
+    for(size_t n = 16; n < maxN; n *= 4)
+    {
+        sizes.push_back(n);
+    }
+    sizes.push_back(maxN);
+
+    for(size_t i = 0; i<sizes.size(); i++)
+    {
+        size_t n = sizes[i];
+        for(int d = 0; d<DIST_COUNT; d++)
+        {
+            vector<T> input = makeInput<T>(d, n, 12345 + d);
+            benchResult r = runOne<T>(sorter, input);
+            csv<<algo<<","<<type<<","<<distName(d)<<","<<n<<","
+               <<r.nsPerElem<<","<<r.compares<<","<<r.swaps<<"\n";
+        }
+        csv.flush();
+    }
+}
+
+template<class T>
+void benchType(ostream& csv, const char* type, size_t maxN)
+{
+    //选择排序是O(n^2), 规模限制在16K以内
+    benchAlgo<T>(csv, "mysort", type, [](auto* a, int n) { mysort(a, n); }, min<size_t>(maxN, 1 << 14));
+    benchAlgo<T>(csv, "std::sort", type, [](auto* a, int n) { sort(a, a + n); }, maxN);
+    benchAlgo<T>(csv, "std::stable_sort", type, [](auto* a, int n) { stable_sort(a, a + n); }, maxN);
+    benchAlgo<T>(csv, "heap_sort", type, [](auto* a, int n) { make_heap(a, a + n); sort_heap(a, a + n); }, maxN);
+}
+
+int main(int argc, char** argv)
+{
+    size_t maxN = 1 << 20;
+    if(argc > 1)
+    {
+        //规模从16开始, 排序函数的长度参数是int
+        char* end = NULL;
+        maxN = strtoull(argv[1], &end, 10);
+        if(end == argv[1] || *end != '\0' || maxN < 16 || maxN > size_t(INT_MAX))
+        {
+            cerr<<"usage: "<<argv[0]<<" [max size, 16.."<<INT_MAX<<"] [csv file]"<<endl;
+            return 1;
+        }
+    }
+
+    ofstream file;
+    if(argc > 2)
+    {
+        file.open(argv[2]);
+    }
+    ostream& csv = file.is_open() ? file : cout;
+
+    csv<<"algorithm,type,distribution,n,ns_per_elem,compares,swaps\n";
+    benchType<uint32_t>(csv, "uint32", maxN);
+    benchType<record>(csv, "record64", maxN);
+
+    system("pause");
+}
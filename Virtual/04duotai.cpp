@@ -0,0 +1,259 @@
+#include<iostream>
+#include<vector>
+#include<variant>
+#include<tuple>
+#include<memory>
+#include<random>
+#include<chrono>
+#include<utility>
+#include<cstdlib>
+using namespace std;
+
+//不用虚函数的多态
+//虚函数: 每个对象单独new, 调用时查虚表, 编译器不知道会调到哪个函数, 没法内联
+//variant: 对象直接存在数组里, std::visit按类型编号跳转到对应的函数, 函数体可以内联
+//按类型分桶: 同一种动物放在同一个数组里, 一个桶一个循环, 循环里调用的函数是确定的, 可以内联和向量化
+//          代价是不再保持原来的先后顺序, 适合"对每个对象做一遍"这种不关心顺序的操作
+//
+//三种写法用的是同一份cat/dog/bird, 它们自己没有虚函数
+
+class cat
+{
+public:
+    cat(int l = 9, int m = 0) : lives(l), mood(m) {}
+
+    int speak() const
+    {
+        return lives * 2 + mood;
+    }
+
+    int lives;
+    int mood;
+};
+
+class dog
+{
+public:
+    dog(int v = 3) : volume(v) {}
+
+    int speak() const
+    {
+        return volume * 3;
+    }
+
+    int volume;
+};
+
+class bird
+{
+public:
+    bird(int s = 1, int p = 0) : songs(s), pitch(p) {}
+
+    int speak() const
+    {
+        return songs + pitch * 4;
+    }
+
+    int songs;
+    int pitch;
+};
+
+//----------------虚函数----------------
+
+class animal
+{
+public:
+    virtual ~animal() {}
+    virtual int speak() const = 0;
+};
+
+template<class T>
+class animalOf : public animal
+{
+public:
+    explicit animalOf(const T& v) : impl(v) {}
+
+    int speak() const override
+    {
+        return impl.speak();
+    }
+
+    T impl;
+};
+
+//----------------variant----------------
+
+typedef variant<cat, dog, bird> anyAnimal;
+
+//----------------按类型分桶----------------
+
+template<class... Ts>
+class typeBuckets
+{
+public:
+    template<class T>
+    void add(const T& v)
+    {
+        get<vector<T>>(buckets).push_back(v);
+    }
+
+    template<class T>
+    vector<T>& bucket()
+    {
+        return get<vector<T>>(buckets);
+    }
+
+    size_t size() const
+    {
+        return apply([](const auto&... b) { return (b.size() + ... + 0); }, buckets);
+    }
+
+    //fn是泛型lambda, 对每个桶实例化一次, 每个循环里的fn(x)调用的都是确定的函数
+    template<class Fn>
+    void forEach(Fn fn)
+    {
+        apply([&fn](auto&... b)
+        {
+            (forEachIn(b, fn), ...);
+        }, buckets);
+    }
+
+private:
+    template<class T, class Fn>
+    static void forEachIn(vector<T>& v, Fn& fn)
+    {
+        for(size_t i = 0; i<v.size(); i++)
+        {
+            fn(v[i]);
+        }
+    }
+
+    tuple<vector<Ts>...> buckets;
+};
+
+void test01()
+{
+    cat ca01(9, 1);
+    dog do01(4);
+    bird bi01(2, 3);
+
+    vector<unique_ptr<animal>> zoo;
+    zoo.push_back(unique_ptr<animal>(new animalOf<cat>(ca01)));
+    zoo.push_back(unique_ptr<animal>(new animalOf<dog>(do01)));
+    zoo.push_back(unique_ptr<animal>(new animalOf<bird>(bi01)));
+    for(size_t i = 0; i<zoo.size(); i++)
+    {
+        cout<<"virtual: "<<zoo[i]->speak()<<endl;
+    }
+
+    vector<anyAnimal> zoo2 = {ca01, do01, bi01};
+    for(size_t i = 0; i<zoo2.size(); i++)
+    {
+        cout<<"variant: "<<visit([](const auto& a) { return a.speak(); }, zoo2[i])<<endl;
+    }
+
+    typeBuckets<cat, dog, bird> zoo3;
+    zoo3.add(ca01);
+    zoo3.add(do01);
+    zoo3.add(bi01);
+    zoo3.forEach([](const auto& a)
+    {
+        cout<<"bucket: "<<a.speak()<<endl;
+    });
+}
+
+template<class Fn>
+double timeIt(Fn fn, long long& result)
+{
+    auto t0 = chrono::steady_clock::now();
+    result = fn();
+    auto t1 = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(t1 - t0).count();
+}
+
+void test02(int n)
+{
+    //三种动物随机混在一起
+    mt19937 rng(7);
+    vector<int> kinds(n);
+    for(int i = 0; i<n; i++)
+    {
+        kinds[i] = int(rng() % 3);
+    }
+
+    vector<unique_ptr<animal>> zoo;
+    vector<anyAnimal> zoo2;
+    typeBuckets<cat, dog, bird> zoo3;
+    zoo.reserve(n);
+    zoo2.reserve(n);
+    for(int i = 0; i<n; i++)
+    {
+        int a = i % 10;
+        switch(kinds[i])
+        {
+        case 0:
+            zoo.push_back(unique_ptr<animal>(new animalOf<cat>(cat(a, 1))));
+            zoo2.push_back(cat(a, 1));
+            zoo3.add(cat(a, 1));
+            break;
+        case 1:
+            zoo.push_back(unique_ptr<animal>(new animalOf<dog>(dog(a))));
+            zoo2.push_back(dog(a));
+            zoo3.add(dog(a));
+            break;
+        default:
+            zoo.push_back(unique_ptr<animal>(new animalOf<bird>(bird(a, 2))));
+            zoo2.push_back(bird(a, 2));
+            zoo3.add(bird(a, 2));
+            break;
+        }
+    }
+
+    const int reps = 5;
+    long long r1 = 0, r2 = 0, r3 = 0;
+    double t1 = timeIt([&zoo, reps]()
+    {
+        long long s = 0;
+        for(int r = 0; r<reps; r++)
+        {
+            for(size_t i = 0; i<zoo.size(); i++)
+            {
+                s += zoo[i]->speak();
+            }
+        }
+        return s;
+    }, r1);
+    double t2 = timeIt([&zoo2, reps]()
+    {
+        long long s = 0;
+        for(int r = 0; r<reps; r++)
+        {
+            for(size_t i = 0; i<zoo2.size(); i++)
+            {
+                s += visit([](const auto& a) { return a.speak(); }, zoo2[i]);
+            }
+        }
+        return s;
+    }, r2);
+    double t3 = timeIt([&zoo3, reps]()
+    {
+        long long s = 0;
+        for(int r = 0; r<reps; r++)
+        {
+            zoo3.forEach([&s](const auto& a) { s += a.speak(); });
+        }
+        return s;
+    }, r3);
+
+    cout<<n<<" mixed animals x"<<reps<<": virtual "<<t1<<" ms, variant "<<t2<<" ms, buckets "<<t3<<" ms ("
+        <<(r1 == r2 && r2 == r3 ? "same" : "DIFFERENT")<<")"<<endl;
+}
+
+int main(int argc, char** argv)
+{
+    test01();
+    test02(argc > 1 ? atoi(argv[1]) : 10000000);
+
+    system("pause");
+    return 0;
+}
@@ -0,0 +1,318 @@
+#include<iostream>
+#include<vector>
+#include<memory>
+#include<random>
+#include<chrono>
+#include<cstdint>
+#include<stdexcept>
+#include<cstdlib>
+using namespace std;
+
+//按列批量算票价
+//原来(Virtual/02): 每张票new一个adult/child, 调一次虚函数buyTicket, 再delete
+//现在票是几列数据: 类别、是否周末、是否会员、张数; 价格规则是一张表, 每个类别一行
+//设置规则时就把规则表"编译"成单价表unit[类别][周末][会员], 算价格时所有行只扫一遍, 每行查一次表再乘张数
+//自定义的Ticket子类照样能用: 这些行的类别是CUSTOM, 最后单独一个个调虚函数(慢路径)
+//单价和总价都用int64_t算, 单价再高、张数再多也不会溢出
+
+enum ticketCategory
+{
+    CAT_ADULT,
+    CAT_CHILD,
+    CAT_SENIOR,
+    CAT_STUDENT,
+    CAT_COUNT,
+    CAT_CUSTOM = 255
+};
+
+//一行票在慢路径里看到的样子
+struct ticketRow
+{
+    bool weekend;
+    bool member;
+    int32_t quantity;
+};
+
+//价格都用分(整数)表示, 没有舍入误差
+class Ticket
+{
+public:
+    virtual ~Ticket() {}
+    virtual int64_t price(const ticketRow& row) const = 0;
+};
+
+//价格规则: (基础价 + 周末加价) * (100 - 会员折扣%) / 100, 再乘张数
+struct priceRule
+{
+    int32_t base;
+    int32_t weekendExtra;
+    int32_t memberDiscountPct;
+
+    int64_t unitPrice(bool weekend, bool member) const
+    {
+        return (int64_t(base) + (weekend ? weekendExtra : 0)) * (100 - (member ? memberDiscountPct : 0)) / 100;
+    }
+};
+
+//原来的写法: 规则写死在各个子类的虚函数里
+class adult : public Ticket
+{
+public:
+    explicit adult(const priceRule& r) : rule(r) {}
+    int64_t price(const ticketRow& row) const override
+    {
+        return rule.unitPrice(row.weekend, row.member) * row.quantity;
+    }
+    priceRule rule;
+};
+
+class child : public Ticket
+{
+public:
+    explicit child(const priceRule& r) : rule(r) {}
+    int64_t price(const ticketRow& row) const override
+    {
+        return rule.unitPrice(row.weekend, row.member) * row.quantity;
+    }
+    priceRule rule;
+};
+
+//规则表里没有的特殊票, 比如团体票: 10张以上打八折
+class groupTicket : public Ticket
+{
+public:
+    int64_t price(const ticketRow& row) const override
+    {
+        int64_t unit = row.weekend ? 45000 : 40000;
+        return row.quantity >= 10 ? unit * row.quantity * 8 / 10 : unit * row.quantity;
+    }
+};
+
+class ticketBatch
+{
+public:
+    void reserve(size_t n)
+    {
+        category.reserve(n);
+        weekend.reserve(n);
+        member.reserve(n);
+        quantity.reserve(n);
+    }
+
+    //只接受规则表里有的类别; CAT_CUSTOM的行必须带票对象, 要用addCustom
+    void add(ticketCategory c, bool w, bool m, int32_t q)
+    {
+        if(c < 0 || c >= CAT_COUNT)
+        {
+            throw out_of_range("ticket category has no price rule");
+        }
+        push(c, w, m, q);
+    }
+
+    //自定义票: 对象归batch所有, 同一个对象可以被很多行共用
+    void addCustom(shared_ptr<const Ticket> t, bool w, bool m, int32_t q)
+    {
+        if(!t)
+        {
+            throw invalid_argument("custom ticket is null");
+        }
+        customRows.push_back(uint32_t(category.size()));
+        customTickets.push_back(t);
+        push(CAT_CUSTOM, w, m, q);
+    }
+
+    size_t size() const { return category.size(); }
+
+    vector<uint8_t> category;
+    vector<uint8_t> weekend;
+    vector<uint8_t> member;
+    vector<int32_t> quantity;
+    vector<uint32_t> customRows;
+    vector<shared_ptr<const Ticket>> customTickets;
+
+private:
+    void push(ticketCategory c, bool w, bool m, int32_t q)
+    {
+        category.push_back(uint8_t(c));
+        weekend.push_back(w ? 1 : 0);
+        member.push_back(m ? 1 : 0);
+        quantity.push_back(q);
+    }
+};
+
+class pricingEngine
+{
+public:
+    //没有规则的类别(包括CUSTOM)单价都是0, CUSTOM的行最后由慢路径覆盖
+    pricingEngine()
+    {
+        for(int c = 0; c<256; c++)
+        {
+            for(int k = 0; k<4; k++)
+            {
+                unit[c][k] = 0;
+            }
+        }
+    }
+
+    void setRule(ticketCategory c, const priceRule& r)
+    {
+        if(c < 0 || c >= CAT_COUNT)
+        {
+            throw out_of_range("ticket category has no price rule");
+        }
+        unit[c][0] = r.unitPrice(false, false);
+        unit[c][1] = r.unitPrice(false, true);
+        unit[c][2] = r.unitPrice(true, false);
+        unit[c][3] = r.unitPrice(true, true);
+    }
+
+    //out的大小会被设成batch.size()
+    //一遍扫完所有列, 每行只写一次; 表有256行, 任何类别字节都不会越界, 循环里没有分支
+    void price(const ticketBatch& batch, vector<int64_t>& out) const
+    {
+        size_t n = batch.size();
+        out.resize(n);
+        const uint8_t* __restrict cat = batch.category.data();
+        const uint8_t* __restrict wk = batch.weekend.data();
+        const uint8_t* __restrict mb = batch.member.data();
+        const int32_t* __restrict qty = batch.quantity.data();
+        int64_t* __restrict o = out.data();
+        for(size_t i = 0; i<n; i++)
+        {
+            o[i] = unit[cat[i]][wk[i] * 2 + mb[i]] * qty[i];
+        }
+
+        //慢路径
+        for(size_t k = 0; k<batch.customRows.size(); k++)
+        {
+            uint32_t i = batch.customRows[k];
+            ticketRow row = {batch.weekend[i] != 0, batch.member[i] != 0, batch.quantity[i]};
+            out[i] = batch.customTickets[k]->price(row);
+        }
+    }
+
+private:
+    int64_t unit[256][4];
+};
+
+static const priceRule adultRule = {50000, 10000, 10};
+static const priceRule childRule = {0, 0, 0};
+static const priceRule seniorRule = {25000, 5000, 20};
+static const priceRule studentRule = {30000, 10000, 15};
+
+void test01()
+{
+    pricingEngine engine;
+    engine.setRule(CAT_ADULT, adultRule);
+    engine.setRule(CAT_CHILD, childRule);
+    engine.setRule(CAT_SENIOR, seniorRule);
+    engine.setRule(CAT_STUDENT, studentRule);
+
+    ticketBatch batch;
+    batch.add(CAT_ADULT, false, false, 1);
+    batch.add(CAT_CHILD, false, false, 1);
+    batch.add(CAT_ADULT, true, true, 2);
+    batch.add(CAT_SENIOR, false, true, 1);
+    batch.add(CAT_STUDENT, true, false, 3);
+    batch.addCustom(make_shared<groupTicket>(), false, false, 12);
+
+    //一次买十万张, 总价超过了int32_t的范围
+    batch.add(CAT_ADULT, true, true, 100000);
+
+    vector<int64_t> prices;
+    engine.price(batch, prices);
+    const char* names[] = {"adult", "child", "senior", "student"};
+    for(size_t i = 0; i<batch.size(); i++)
+    {
+        const char* name = batch.category[i] == CAT_CUSTOM ? "custom" : names[batch.category[i]];
+        cout<<name<<" buy ticket "<<prices[i] / 100<<"."<<(prices[i] % 100 < 10 ? "0" : "")<<prices[i] % 100<<endl;
+    }
+
+    try
+    {
+        batch.add(ticketCategory(CAT_CUSTOM), false, false, 1);
+    }
+    catch(const out_of_range& e)
+    {
+        cout<<"error: "<<e.what()<<endl;
+    }
+}
+
+void test02()
+{
+    const size_t n = 5000000;
+    mt19937 rng(11);
+    pricingEngine engine;
+    engine.setRule(CAT_ADULT, adultRule);
+    engine.setRule(CAT_CHILD, childRule);
+    engine.setRule(CAT_SENIOR, seniorRule);
+    engine.setRule(CAT_STUDENT, studentRule);
+    const priceRule* ruleOf[] = {&adultRule, &childRule, &seniorRule, &studentRule};
+
+    //99%是普通票, 1%是自定义的团体票
+    ticketBatch batch;
+    batch.reserve(n);
+    shared_ptr<const Ticket> group = make_shared<groupTicket>();
+    for(size_t i = 0; i<n; i++)
+    {
+        bool w = rng() % 7 >= 5;
+        bool m = rng() % 3 == 0;
+        int32_t q = 1 + int32_t(rng() % 4);
+        if(rng() % 100 == 0)
+        {
+            batch.addCustom(group, w, m, 8 + q);
+        }
+        else
+        {
+            batch.add(ticketCategory(rng() % CAT_COUNT), w, m, q);
+        }
+    }
+
+    //原来的写法: 每张票new一个对象, 调虚函数, 再delete
+    auto t0 = chrono::steady_clock::now();
+    long long total1 = 0;
+    for(size_t i = 0; i<n; i++)
+    {
+        ticketRow row = {batch.weekend[i] != 0, batch.member[i] != 0, batch.quantity[i]};
+        Ticket* ti;
+        uint8_t c = batch.category[i];
+        if(c == CAT_CUSTOM)
+        {
+            ti = new groupTicket();
+        }
+        else if(c == CAT_CHILD)
+        {
+            ti = new child(*ruleOf[c]);
+        }
+        else
+        {
+            ti = new adult(*ruleOf[c]);
+        }
+        total1 += ti->price(row);
+        delete ti;
+    }
+    auto t1 = chrono::steady_clock::now();
+
+    vector<int64_t> prices;
+    engine.price(batch, prices);
+    auto t2 = chrono::steady_clock::now();
+    long long total2 = 0;
+    for(size_t i = 0; i<n; i++)
+    {
+        total2 += prices[i];
+    }
+
+    cout<<n<<" tickets: new + virtual + delete "<<chrono::duration<double, milli>(t1 - t0).count()
+        <<" ms, columnar engine "<<chrono::duration<double, milli>(t2 - t1).count()<<" ms ("
+        <<(total1 == total2 ? "same" : "DIFFERENT")<<" total)"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+
+    system("pause");
+    return 0;
+}
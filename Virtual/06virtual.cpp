@@ -0,0 +1,326 @@
+#include<iostream>
+#include<vector>
+#include<string>
+#include<new>
+#include<utility>
+#include<type_traits>
+#include<chrono>
+#include<cstddef>
+#include<cstdlib>
+using namespace std;
+
+//放多态对象的分配区(arena)
+//不同的派生类对象一个挨一个放在大块内存里, 分配就是挪指针, 返回的指针可以直接当基类指针用
+//需要析构的对象在它前面记一个小节点(下一个节点, 析构函数), 串成链表; 不需要析构的类型(trivially destructible)什么都不记
+//reset()沿链表按构造的相反顺序调用析构函数, 然后把指针挪回开头, 整批对象一次释放
+//记下的析构函数是具体类型的T::~T(), 直接调用, 不走虚表
+
+class objectArena
+{
+public:
+    explicit objectArena(size_t firstChunk = 64 * 1024)
+        : chunks(NULL), cur(NULL), end(NULL), nextSize(firstChunk), dtors(NULL), objects(0), destructible(0) {}
+
+    ~objectArena()
+    {
+        runDestructors();
+        freeChunks(NULL);
+    }
+
+    objectArena(const objectArena&) = delete;
+    objectArena& operator=(const objectArena&) = delete;
+
+    template<class T, class... Args>
+    T* create(Args&&... args)
+    {
+        if constexpr(is_trivially_destructible<T>::value)
+        {
+            void* p = bump(sizeof(T), alignof(T));
+            T* obj = new(p) T(std::forward<Args>(args)...);
+            objects++;
+            return obj;
+        }
+
+        //节点和对象连在一起分配: [dtorNode][对齐填充][T]
+        char* mark = cur;
+        chunk* markChunk = chunks;
+        dtorNode* node = static_cast<dtorNode*>(bump(sizeof(dtorNode), alignof(dtorNode)));
+        void* p = bump(sizeof(T), alignof(T));
+        T* obj;
+        try
+        {
+            obj = new(p) T(std::forward<Args>(args)...);
+        }
+        catch(...)
+        {
+            //构造失败: 同一块里就把指针挪回去; 换了新块就算了, 浪费一点空间
+            if(chunks == markChunk)
+            {
+                cur = mark;
+            }
+            throw;
+        }
+        node->object = obj;
+        node->destroy = &destroyAs<T>;
+        node->next = dtors;
+        dtors = node;
+        objects++;
+        destructible++;
+        return obj;
+    }
+
+    //析构所有对象, 只留下最大的一块内存给下一轮用
+    void reset()
+    {
+        runDestructors();
+        freeChunks(chunks);
+        if(chunks != NULL)
+        {
+            cur = reinterpret_cast<char*>(chunks) + sizeof(chunk);
+            end = reinterpret_cast<char*>(chunks) + chunks->size;
+        }
+        objects = 0;
+        destructible = 0;
+    }
+
+    size_t objectCount() const { return objects; }
+    size_t destructorCount() const { return destructible; }
+
+private:
+    struct chunk
+    {
+        chunk* next;
+        size_t size;
+    };
+
+    struct dtorNode
+    {
+        dtorNode* next;
+        void (*destroy)(void*);
+        void* object;
+    };
+
+    //限定名调用T::~T(), 即使析构函数是虚的也不查虚表
+    template<class T>
+    static void destroyAs(void* p)
+    {
+        static_cast<T*>(p)->T::~T();
+    }
+
+    void* bump(size_t size, size_t align)
+    {
+        size_t pad = (align - reinterpret_cast<size_t>(cur) % align) % align;
+        if(cur == NULL || pad + size > size_t(end - cur))
+        {
+            newChunk(size + align);
+            pad = (align - reinterpret_cast<size_t>(cur) % align) % align;
+        }
+        void* p = cur + pad;
+        cur += pad + size;
+        return p;
+    }
+
+    void newChunk(size_t atLeast)
+    {
+        size_t size = max(nextSize, atLeast + sizeof(chunk));
+        nextSize = size * 2;
+        chunk* c = static_cast<chunk*>(::operator new(size));
+        c->next = chunks;
+        c->size = size;
+        chunks = c;
+        cur = reinterpret_cast<char*>(c) + sizeof(chunk);
+        end = reinterpret_cast<char*>(c) + size;
+    }
+
+    //新块总是加在链表头上, 所以头上的块最大; keep不为NULL时保留它
+    void freeChunks(chunk* keep)
+    {
+        chunk* c = chunks;
+        while(c != NULL)
+        {
+            chunk* next = c->next;
+            if(c != keep)
+            {
+                ::operator delete(c);
+            }
+            c = next;
+        }
+        chunks = keep;
+        if(keep != NULL)
+        {
+            keep->next = NULL;
+        }
+        else
+        {
+            cur = NULL;
+            end = NULL;
+        }
+    }
+
+    //链表头是最后构造的对象, 顺着走就是构造的相反顺序
+    void runDestructors()
+    {
+        while(dtors != NULL)
+        {
+            dtorNode* next = dtors->next;
+            dtors->destroy(dtors->object);
+            dtors = next;
+        }
+    }
+
+    chunk* chunks;
+    char* cur;
+    char* end;
+    size_t nextSize;
+    dtorNode* dtors;
+    size_t objects;
+    size_t destructible;
+};
+
+class preson
+{
+public:
+    virtual ~preson() {}
+    virtual int doSpeak() const = 0;
+};
+
+class adult : public preson
+{
+public:
+    adult(string n) : name(n) {}
+    ~adult()
+    {
+        if(verbose)
+        {
+            cout<<"adult's xigou function: "<<name<<endl;
+        }
+    }
+    int doSpeak() const override
+    {
+        return int(name.size());
+    }
+
+    string name;
+    static bool verbose;
+};
+
+bool adult::verbose = false;
+
+//没有需要释放的成员, 但是有虚析构函数, 所以不是trivially destructible
+class child : public preson
+{
+public:
+    child(int a) : age(a) {}
+    int doSpeak() const override
+    {
+        return age;
+    }
+
+    int age;
+};
+
+//普通的结构体, 不用析构
+struct ticketStub
+{
+    int price;
+    int seat;
+};
+
+void test01()
+{
+    adult::verbose = true;
+    objectArena arena;
+    vector<preson*> people;
+    people.push_back(arena.create<adult>("zhangsan"));
+    people.push_back(arena.create<child>(8));
+    people.push_back(arena.create<adult>("lisi"));
+    ticketStub* t = arena.create<ticketStub>(ticketStub{500, 12});
+
+    for(size_t i = 0; i<people.size(); i++)
+    {
+        cout<<"doSpeak: "<<people[i]->doSpeak()<<endl;
+    }
+    cout<<"ticket "<<t->price<<" seat "<<t->seat<<endl;
+    cout<<arena.objectCount()<<" objects, "<<arena.destructorCount()<<" need destructors"<<endl;
+
+    arena.reset();
+    cout<<"after reset: "<<arena.objectCount()<<" objects"<<endl;
+    adult::verbose = false;
+}
+
+void test02()
+{
+    //模拟一个请求里创建的对象: 成人、儿童、票各三分之一
+    const int n = 1000000;
+    const int requests = 10;
+    long long s1 = 0, s2 = 0;
+
+    auto t0 = chrono::steady_clock::now();
+    for(int r = 0; r<requests; r++)
+    {
+        vector<preson*> people;
+        vector<ticketStub*> tickets;
+        people.reserve(n);
+        tickets.reserve(n / 3 + 1);
+        for(int i = 0; i<n; i++)
+        {
+            switch(i % 3)
+            {
+            case 0: people.push_back(new adult("preson")); break;
+            case 1: people.push_back(new child(i % 18)); break;
+            default: tickets.push_back(new ticketStub{i % 500, i}); break;
+            }
+        }
+        for(size_t i = 0; i<people.size(); i++)
+        {
+            s1 += people[i]->doSpeak();
+            delete people[i];
+        }
+        for(size_t i = 0; i<tickets.size(); i++)
+        {
+            s1 += tickets[i]->price;
+            delete tickets[i];
+        }
+    }
+    auto t1 = chrono::steady_clock::now();
+
+    objectArena arena;
+    for(int r = 0; r<requests; r++)
+    {
+        vector<preson*> people;
+        vector<ticketStub*> tickets;
+        people.reserve(n);
+        tickets.reserve(n / 3 + 1);
+        for(int i = 0; i<n; i++)
+        {
+            switch(i % 3)
+            {
+            case 0: people.push_back(arena.create<adult>("preson")); break;
+            case 1: people.push_back(arena.create<child>(i % 18)); break;
+            default: tickets.push_back(arena.create<ticketStub>(ticketStub{i % 500, i})); break;
+            }
+        }
+        for(size_t i = 0; i<people.size(); i++)
+        {
+            s2 += people[i]->doSpeak();
+        }
+        for(size_t i = 0; i<tickets.size(); i++)
+        {
+            s2 += tickets[i]->price;
+        }
+        arena.reset();
+    }
+    auto t2 = chrono::steady_clock::now();
+
+    cout<<requests<<" requests x "<<n<<" objects: new/delete "<<chrono::duration<double, milli>(t1 - t0).count()
+        <<" ms, arena "<<chrono::duration<double, milli>(t2 - t1).count()<<" ms ("<<(s1 == s2 ? "same" : "DIFFERENT")<<")"<<endl;
+}
+
+int main()
+{
+    test01();
+    test02();
+
+    system("pause");
+    return 0;
+}